@@ -0,0 +1,74 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_BENCHMARK_COMMON_HH
+#define SIMPLE_MIPS_ASM_BENCHMARK_COMMON_HH
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/// <summary>
+/// Generates an instruction-heavy assembly source of approximately the given size in bytes.
+/// </summary>
+inline std::string GenerateSource(size_t size)
+{
+    std::string code = "        .data\n"
+                       "array:  .word   3\n"
+                       "        .word   0x12345678\n"
+                       "        .text\n";
+    for (size_t block = 0; code.size() < size; ++block)
+    {
+        auto label = "block" + std::to_string(block);
+        code += label + ":\n";
+        code += "        addiu   $2, $0, 1024\n"
+                "        addu    $3, $2, $2\n"
+                "        or      $4, $3, $2\n"
+                "        sll     $6, $5, 16\n"
+                "        ori     $10, $2, 0xFF\n"
+                "        la      $4, array\n"
+                "        lw      $9, 0($4)\n"
+                "        sb      $2, 6($4)\n"
+                "        sltiu   $1, $2, 1\n";
+        code += "        bne     $1, $0, " + label + "\n";
+        code += "        j       " + label + "\n";
+        code += "        jr      $31\n";
+    }
+    return code;
+}
+
+/// <summary>
+/// Returns the size of the benchmark input given by the first command line argument in megabytes.
+/// </summary>
+inline size_t GetInputSize(int argc, char* argv[])
+{
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+    return (megabytes ? megabytes : 16) << 20;
+}
+
+/// <summary>
+/// Runs the given function several times and prints the best throughput.
+/// </summary>
+template <typename Function>
+double Measure(char const* name, size_t numBytes, Function&& function, int numRuns = 5)
+{
+    using Clock = std::chrono::steady_clock;
+
+    double best = 0.0;
+    for (int i = 0; i < numRuns; ++i)
+    {
+        auto begin = Clock::now();
+        function();
+        auto   end     = Clock::now();
+        double seconds = std::chrono::duration<double>(end - begin).count();
+        double speed   = numBytes / seconds;
+        if (best < speed)
+            best = speed;
+    }
+
+    std::printf("%-24s %10.2f MB/s\n", name, best / (1 << 20));
+    return best;
+}
+
+#endif
@@ -0,0 +1,235 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+// Packs the fields of 16 instructions at a time with vector shifts and ORs, and compares it with
+// the scalar encoder of GenerateCode. The fields have to be copied from the fragments into the
+// slot arrays first, which costs more than the few shifts and the store the scalar encoder needs
+// for a word, so the batch encoder is kept here instead of in the code generator.
+
+#include <simple-mips-asm/Generation.hh>
+#include <simple-mips-asm/Parsing.hh>
+
+#include "../Source/CpuFeatures.hh"
+#include "BenchmarkCommon.hh"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace
+{
+
+/// <summary>
+/// The number of instructions a batch encoder packs at once.
+/// </summary>
+constexpr size_t BatchSize = 16;
+
+/// <summary>
+/// The number of the slots of an instruction word, which are opcode, rs, rt, rd, shamt, and the
+/// function or the immediate in order.
+/// </summary>
+constexpr size_t NumSlots = 6;
+
+constexpr uint32_t SlotShifts[NumSlots] = { 26, 21, 16, 11, 6, 0 };
+constexpr uint32_t SlotWidths[NumSlots] = { 6, 5, 5, 5, 5, 16 };
+
+constexpr uint32_t MaskOf(size_t slot) noexcept
+{
+    return (uint32_t(1) << SlotWidths[slot]) - 1;
+}
+
+/// <summary>
+/// Represents the fields of a batch of instructions stored slot by slot, so that they can be
+/// packed with vector instructions. A slot an instruction does not have is zero.
+/// </summary>
+struct InstructionBatch
+{
+    uint32_t slots[NumSlots][BatchSize];
+};
+
+using BatchEncoder = void (*)(InstructionBatch const& batch, size_t count, uint32_t* output);
+
+// ------------------------------------------ Scalar ------------------------------------------- //
+
+void EncodeBatchScalar(InstructionBatch const& batch, size_t count, uint32_t* output)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t word = 0;
+        for (size_t slot = 0; slot < NumSlots; ++slot)
+            word |= (batch.slots[slot][i] & MaskOf(slot)) << SlotShifts[slot];
+        output[i] = word;
+    }
+}
+
+#ifdef SIMPLE_MIPS_ASM_X64
+
+// ------------------------------------------- SSE2 -------------------------------------------- //
+
+// Loads 4 values of the given slot and moves them to the slot.
+template <size_t Slot>
+inline __m128i PackSSE2(InstructionBatch const& batch, size_t i)
+{
+    __m128i value = _mm_loadu_si128(reinterpret_cast<__m128i const*>(batch.slots[Slot] + i));
+    return _mm_slli_epi32(_mm_and_si128(value, _mm_set1_epi32(MaskOf(Slot))), SlotShifts[Slot]);
+}
+
+void EncodeBatchSSE2(InstructionBatch const& batch, size_t count, uint32_t* output)
+{
+    // the words after count are packed into a buffer and dropped
+    alignas(16) uint32_t words[BatchSize];
+    for (size_t i = 0; i < count; i += 4)
+    {
+        __m128i high = _mm_or_si128(PackSSE2<0>(batch, i), PackSSE2<1>(batch, i));
+        __m128i mid  = _mm_or_si128(PackSSE2<2>(batch, i), PackSSE2<3>(batch, i));
+        __m128i low  = _mm_or_si128(PackSSE2<4>(batch, i), PackSSE2<5>(batch, i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(words + i),
+                        _mm_or_si128(_mm_or_si128(high, mid), low));
+    }
+    std::memcpy(output, words, count * sizeof(uint32_t));
+}
+
+// ------------------------------------------- AVX2 -------------------------------------------- //
+
+// Loads 8 values of the given slot and moves them to the slot.
+template <size_t Slot>
+SIMPLE_MIPS_ASM_TARGET_AVX2 inline __m256i PackAVX2(InstructionBatch const& batch, size_t i)
+{
+    __m256i value = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(batch.slots[Slot] + i));
+    return _mm256_slli_epi32(_mm256_and_si256(value, _mm256_set1_epi32(MaskOf(Slot))),
+                             SlotShifts[Slot]);
+}
+
+SIMPLE_MIPS_ASM_TARGET_AVX2 void
+    EncodeBatchAVX2(InstructionBatch const& batch, size_t count, uint32_t* output)
+{
+    alignas(32) uint32_t words[BatchSize];
+    for (size_t i = 0; i < count; i += 8)
+    {
+        __m256i high = _mm256_or_si256(PackAVX2<0>(batch, i), PackAVX2<1>(batch, i));
+        __m256i mid  = _mm256_or_si256(PackAVX2<2>(batch, i), PackAVX2<3>(batch, i));
+        __m256i low  = _mm256_or_si256(PackAVX2<4>(batch, i), PackAVX2<5>(batch, i));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(words + i),
+                           _mm256_or_si256(_mm256_or_si256(high, mid), low));
+    }
+    std::memcpy(output, words, count * sizeof(uint32_t));
+}
+
+#endif
+
+// ------------------------------------------ Slots -------------------------------------------- //
+
+void ToSlots(RFormatData const& data, InstructionBatch& batch, size_t i)
+{
+    batch.slots[1][i] = data.source1;
+    batch.slots[2][i] = data.source2;
+    batch.slots[3][i] = data.destination;
+    batch.slots[5][i] = static_cast<uint32_t>(data.function);
+}
+
+void ToSlots(IFormatData const& data, InstructionBatch& batch, size_t i)
+{
+    batch.slots[0][i] = static_cast<uint32_t>(data.operation);
+    batch.slots[1][i] = data.source;
+    batch.slots[2][i] = data.destination;
+    batch.slots[5][i] = data.immediate;
+}
+
+void ToSlots(OIFormatData const& data, InstructionBatch& batch, size_t i)
+{
+    batch.slots[0][i] = static_cast<uint32_t>(data.operation);
+    batch.slots[1][i] = data.operand1;
+    batch.slots[2][i] = data.operand2;
+    batch.slots[5][i] = data.offset;
+}
+
+// the input has no other instructions
+template <typename Data>
+void ToSlots(Data const&, InstructionBatch&, size_t)
+{}
+
+/// <summary>
+/// Encodes the given fragments in the way the code generator would with a batch encoder: the
+/// fields of each fragment are gathered into a batch, which is packed when it is full.
+/// </summary>
+void EncodeFragments(std::pmr::vector<Fragment> const& fragments,
+                     BatchEncoder                      encoder,
+                     std::vector<uint32_t>&            output)
+{
+    InstructionBatch batch {};
+    size_t           count = 0;
+
+    auto flush = [&]() {
+        auto size = output.size();
+        output.resize(size + count);
+        encoder(batch, count, output.data() + size);
+        std::memset(&batch, 0, sizeof(batch));
+        count = 0;
+    };
+
+    output.clear();
+    for (auto const& fragment : fragments)
+    {
+        std::visit([&](auto const& data) { ToSlots(data, batch, count); }, fragment.data);
+        if (++count == BatchSize)
+            flush();
+    }
+    flush();
+}
+
+/// <summary>
+/// Generates a source of instructions which do not refer to labels.
+/// </summary>
+std::string GenerateInstructions(size_t size)
+{
+    std::string code;
+    while (code.size() < size)
+    {
+        code += "        addu    $3, $2, $2\n"
+                "        addiu   $2, $0, 1024\n"
+                "        lw      $9, 8($4)\n"
+                "        ori     $10, $2, 0xFF\n";
+    }
+    return code;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    auto code = GenerateInstructions(GetInputSize(argc, argv));
+    std::printf("input: %zu bytes\n", code.size());
+
+    auto fragments = ParseCode(code).parseResult.fragments;
+    auto result    = GenerateCode(fragments);
+    if (!std::holds_alternative<CanGenerate>(result))
+        return 1;
+    auto const& expected = std::get<CanGenerate>(result).text;
+
+    Measure("GenerateCode", code.size(), [&] { GenerateCode(fragments); });
+
+    std::pair<char const*, BatchEncoder> encoders[] = {
+        { "Batch (Scalar)", EncodeBatchScalar },
+#ifdef SIMPLE_MIPS_ASM_X64
+        { "Batch (SSE2)", EncodeBatchSSE2 },
+        { "Batch (AVX2)", IsAVX2Supported() ? EncodeBatchAVX2 : nullptr },
+#endif
+    };
+
+    std::vector<uint32_t> words;
+    for (auto [name, encoder] : encoders)
+    {
+        if (encoder == nullptr)
+            continue;
+
+        EncodeFragments(fragments, encoder, words);
+        if (words.size() != expected.size()
+            || !std::equal(words.begin(), words.end(), expected.begin()))
+        {
+            std::printf("%s: the words are different from GenerateCode\n", name);
+            return 1;
+        }
+        Measure(name, code.size(), [&] { EncodeFragments(fragments, encoder, words); });
+    }
+}
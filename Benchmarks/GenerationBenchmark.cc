@@ -0,0 +1,45 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <simple-mips-asm/Generation.hh>
+#include <simple-mips-asm/Parsing.hh>
+#include <simple-mips-asm/Tokenization.hh>
+
+#include "BenchmarkCommon.hh"
+#include <thread>
+
+int main(int argc, char* argv[])
+{
+    auto code = GenerateSource(GetInputSize(argc, argv));
+    std::printf("input: %zu bytes\n", code.size());
+
+    auto fragments = ParseCode(code).parseResult.fragments;
+    Measure("GenerateCode", code.size(), [&] { GenerateCode(fragments); });
+
+    for (size_t numThreads = 1; numThreads <= std::thread::hardware_concurrency(); numThreads *= 2)
+    {
+        ParallelOptions parallelOptions;
+        parallelOptions.numThreads = numThreads;
+
+        auto name = "GenerateCodeParallel/" + std::to_string(numThreads);
+        Measure(name.c_str(), code.size(), [&] {
+            GenerateCodeParallel(fragments, {}, parallelOptions);
+        });
+    }
+
+    auto encodedCode = EncodeCode(code).code;
+    Measure("GenerateCode (encoded)", code.size(), [&] { GenerateCode(encodedCode); });
+
+    double separate = Measure("ParseCode + GenerateCode", code.size(), [&] {
+        GenerateCode(ParseCode(code).parseResult.fragments);
+    });
+    double fused = Measure("EncodeCode + GenerateCode", code.size(), [&] {
+        GenerateCode(EncodeCode(code).code);
+    });
+    std::printf("speedup: %.2fx\n", fused / separate);
+
+    size_t numWords = encodedCode.data.size() + encodedCode.text.size();
+    std::printf("fragments: %zu bytes, encoded code: %zu bytes\n",
+                fragments.size() * sizeof(Fragment),
+                numWords * sizeof(uint32_t) + encodedCode.fixups.size() * sizeof(Fixup));
+}
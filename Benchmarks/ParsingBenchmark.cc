@@ -0,0 +1,92 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <simple-mips-asm/Parsing.hh>
+#include <simple-mips-asm/Tokenization.hh>
+
+#include "BenchmarkCommon.hh"
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+
+int main(int argc, char* argv[])
+{
+    auto code = GenerateSource(GetInputSize(argc, argv));
+    std::printf("input: %zu bytes\n", code.size());
+
+    auto tokens = Tokenize(code).tokens;
+    Measure("Parse", code.size(), [&] { Parse(tokens); });
+
+    for (size_t numThreads = 1; numThreads <= std::thread::hardware_concurrency(); numThreads *= 2)
+    {
+        ParallelOptions parallelOptions;
+        parallelOptions.numThreads = numThreads;
+
+        auto name = "ParseParallel/" + std::to_string(numThreads);
+        Measure(name.c_str(), code.size(), [&] { ParseParallel(tokens, {}, parallelOptions); });
+    }
+
+    auto compactTokens = TokenizeCompact(code).tokens;
+    Measure("Parse (compact)", code.size(), [&] { Parse(compactTokens); });
+
+    TokenizationOptions options;
+    options.elideWhitespaces = true;
+    options.skipComments     = true;
+
+    auto elidedTokens = Tokenize(code, options).tokens;
+    Measure("Parse (elided)", code.size(), [&] { Parse(elidedTokens); });
+
+    double separate = Measure(
+        "Tokenize + Parse", code.size(), [&] { Parse(Tokenize(code, options).tokens); });
+    Measure("Parse (stream)", code.size(), [&] {
+        TokenStream stream { code, options };
+        Parse(stream);
+    });
+
+    double fused = Measure("ParseCode", code.size(), [&] { ParseCode(code, options); });
+    std::printf("speedup: %.2fx\n", fused / separate);
+
+    // A quadratic algorithm would be SizeFactor times slower on the larger input. The inputs are
+    // hard to parse, since every line is an error or there is only one line.
+    constexpr size_t SmallSize  = 64 << 10;
+    constexpr size_t SizeFactor = 8;
+
+    std::pair<char const*, std::string (*)(size_t)> const pathologicalInputs[] = {
+        { "random bytes",
+          [](size_t size) {
+              std::mt19937 random { 42 };
+              std::string  code(size, '\0');
+              for (auto& c : code) c = static_cast<char>(random());
+              return code;
+          } },
+        { "no new lines",
+          [](size_t size) {
+              std::string code;
+              while (code.size() < size) code += "addu $1, $2, $3 ";
+              return code;
+          } },
+        { "truncated lines",
+          [](size_t size) {
+              std::string code;
+              while (code.size() < size) code += "lw $1, 4($2\n";
+              return code;
+          } },
+    };
+
+    for (auto [name, generate] : pathologicalInputs)
+    {
+        auto small = generate(SmallSize);
+        auto large = generate(SmallSize * SizeFactor);
+
+        auto   smallName  = std::string { name } + "/small";
+        auto   largeName  = std::string { name } + "/large";
+        double smallSpeed = Measure(smallName.c_str(), small.size(), [&] {
+            Parse(Tokenize(small).tokens);
+        });
+        double largeSpeed = Measure(largeName.c_str(), large.size(), [&] {
+            Parse(Tokenize(large).tokens);
+        });
+        std::printf("slowdown: %.2fx\n", smallSpeed / largeSpeed);
+    }
+}
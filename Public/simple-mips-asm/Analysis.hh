@@ -0,0 +1,103 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_ANALYSIS_HH
+#define SIMPLE_MIPS_ASM_ANALYSIS_HH
+
+#include <simple-mips-asm/Parsing.hh>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+/// <summary>
+/// Represents a 5-stage pipeline with forwarding, which runs an instruction per cycle unless it
+/// stalls.
+/// </summary>
+struct PipelineModel
+{
+    /// <summary>
+    /// The cycles an instruction waits if it reads a register the instruction before it loads.
+    /// </summary>
+    uint32_t loadUseStall = 1;
+
+    /// <summary>
+    /// The cycles lost by a branch or a jump, which are counted as if every branch were taken.
+    /// </summary>
+    uint32_t branchPenalty = 1;
+
+    /// <summary>
+    /// Whether the instruction after a branch or a jump runs in its delay slot. The slot is a
+    /// cycle of the penalty, so a branch loses a cycle less, and the slot is in the block of the
+    /// branch.
+    /// </summary>
+    bool hasDelaySlots = false;
+
+    /// <summary>
+    /// How many times a loop is assumed to run, which is used to weigh the blocks in loops. A loop
+    /// is the code from a label to a branch or a j to it after the label.
+    /// </summary>
+    uint32_t loopWeight = 10;
+};
+
+/// <summary>
+/// Represents the estimated cost of a basic block, which is a run of instructions starting after
+/// a label or a branch and ending with a branch or before a label.
+/// </summary>
+struct BlockEstimate
+{
+    Range                   range;            // from the first to the last instruction
+    std::optional<SymbolId> label;            // the last label at the beginning of the block
+    uint32_t                numInstructions;  // an la is counted as lui and ori
+    uint32_t                numStallCycles;   // the load-use stalls
+    uint32_t                numPenaltyCycles; // the cycles lost by the branch at the end
+    uint32_t                loopDepth;        // the number of the loops the block is in
+    uint64_t                cycles;           // the cycles of an execution of the block
+    uint64_t                weightedCycles;   // cycles weighted by the loop depth
+};
+
+/// <summary>
+/// Represents the estimated cost of the code from a label to the next label in the text segment.
+/// </summary>
+struct LabelEstimate
+{
+    SymbolId symbol;
+    Range    range;
+    uint64_t cycles;
+    uint64_t weightedCycles;
+};
+
+/// <summary>
+/// Represents the result of <c>EstimateCycles</c>. The blocks and the labels are sorted by their
+/// weighted cycles in descending order, so the hot spots are first.
+/// </summary>
+struct CycleReport
+{
+    std::pmr::vector<BlockEstimate> blocks;
+    std::pmr::vector<LabelEstimate> labels;
+    uint64_t                        totalCycles = 0; // the sum of the cycles of the blocks
+
+    CycleReport() = default;
+
+    /// <summary>
+    /// Creates an empty report which allocates from the given memory resource.
+    /// </summary>
+    explicit CycleReport(std::pmr::memory_resource* resource) :
+        blocks { resource }, labels { resource }
+    {}
+};
+
+/// <summary>
+/// Estimates the cycles of the text segment of the given fragments on the given pipeline without
+/// running them. The load-use stalls are counted on the fall-through paths, as
+/// <c>CountLoadUseStalls</c> does.
+/// </summary>
+/// <param name="fragments">the array of fragments</param>
+/// <param name="model">the pipeline</param>
+/// <returns>the estimates, which are allocated from the memory resource of the fragments</returns>
+CycleReport EstimateCycles(std::pmr::vector<Fragment> const& fragments,
+                           PipelineModel const&              model = {});
+
+#endif
@@ -0,0 +1,64 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_ARENA_HH
+#define SIMPLE_MIPS_ASM_ARENA_HH
+
+#include <cstddef>
+#include <memory_resource>
+
+/// <summary>
+/// A monotonic memory resource which keeps its memory when it is reset. Allocations are carved out
+/// of a single block, and deallocations do nothing. When the block runs out, the arena falls back
+/// to additional blocks from the upstream resource, which are merged into the main block at the
+/// next reset. So once the arena has grown to the largest input, assembling a file does not call
+/// the upstream resource at all. An arena is not thread-safe.
+/// </summary>
+class Arena : public std::pmr::memory_resource
+{
+  public:
+    /// <summary>
+    /// The size of the main block of an arena unless given.
+    /// </summary>
+    static constexpr size_t DefaultSize = 1 << 20;
+
+  public:
+    explicit Arena(size_t                     size     = DefaultSize,
+                   std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+    Arena(Arena const&)            = delete;
+    Arena& operator=(Arena const&) = delete;
+    ~Arena() override;
+
+  public:
+    /// <summary>
+    /// Releases every allocation at once. If additional blocks were needed since the last reset,
+    /// they are returned to the upstream resource and the main block is replaced with one as large
+    /// as all of them.
+    /// </summary>
+    void Reset();
+
+    /// <summary>
+    /// Returns the number of bytes the arena holds.
+    /// </summary>
+    size_t GetCapacity() const noexcept;
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void  do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+    bool  do_is_equal(std::pmr::memory_resource const& other) const noexcept override;
+
+    void ReleaseOverflow() noexcept;
+
+  private:
+    struct Block;
+
+    std::pmr::memory_resource* _upstream;
+    std::byte*                 _block;
+    size_t                     _blockSize;
+    Block*                     _overflow     = nullptr;
+    size_t                     _overflowSize = 0;
+    std::byte*                 _current;
+    std::byte*                 _end;
+};
+
+#endif
@@ -0,0 +1,80 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_ASSEMBLER_HH
+#define SIMPLE_MIPS_ASM_ASSEMBLER_HH
+
+#include <simple-mips-asm/Arena.hh>
+#include <simple-mips-asm/Generation.hh>
+
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/// <summary>
+/// Represents the result of <c>Assembler::Assemble</c>. The names in <c>symbols</c> refer to the
+/// copy of the source the assembler owns.
+/// </summary>
+struct AssemblyResult
+{
+    std::pmr::vector<TokenizationError> tokenizationErrors;
+    std::pmr::vector<ParsingError>      parsingErrors;
+    SymbolTable                         symbols;
+
+    /// <summary>
+    /// The generated machine code, which is present only if there are no tokenization errors and
+    /// parsing errors.
+    /// </summary>
+    std::optional<GenerationResult> generationResult;
+
+    AssemblyResult() = default;
+
+    /// <summary>
+    /// Creates an empty result which allocates from the given memory resource.
+    /// </summary>
+    explicit AssemblyResult(std::pmr::memory_resource* resource) :
+        tokenizationErrors { resource }, parsingErrors { resource }, symbols { resource }
+    {}
+};
+
+/// <summary>
+/// Assembles code with buffers kept across calls. The assembler owns a copy of the source, which
+/// is overwritten at each call, and every buffer of the pipeline, which are allocated from an
+/// arena rewound at each call instead of being freed. So the result does not depend on the
+/// lifetime of the given code, and once the assembler has seen the largest input, assembling does
+/// not allocate at all. An assembler is not thread-safe.
+/// </summary>
+class Assembler
+{
+  public:
+    explicit Assembler(TokenizationOptions const& tokenizationOptions = {},
+                       ParseOptions const&        options             = {},
+                       GenerationOptions const&   generationOptions   = {},
+                       size_t                     arenaSize           = Arena::DefaultSize);
+    Assembler(Assembler const&)            = delete;
+    Assembler& operator=(Assembler const&) = delete;
+
+  public:
+    /// <summary>
+    /// Assembles the given code. The previous result is released before.
+    /// </summary>
+    /// <param name="code">the code to assemble</param>
+    /// <returns>the result, which is valid until the next call</returns>
+    AssemblyResult const& Assemble(std::string_view code);
+
+    /// <summary>
+    /// Returns the copy of the code given to the last <c>Assemble</c> call.
+    /// </summary>
+    std::string_view GetSource() const noexcept;
+
+  private:
+    TokenizationOptions           _tokenizationOptions;
+    ParseOptions                  _options;
+    GenerationOptions             _generationOptions;
+    Arena                         _arena;
+    std::string                   _source;
+    std::optional<AssemblyResult> _result;
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include <simple-mips-asm/Generation.hh>
 
 #include <filesystem>
+#include <memory_resource>
 #include <string>
 #include <variant>
 
@@ -26,7 +27,7 @@ struct FileReadError
 
 struct CanRead
 {
-    std::string content;
+    std::pmr::string content;
 };
 
 struct CannotRead
@@ -36,7 +37,12 @@ struct CannotRead
 
 using FileReadResult = std::variant<CanRead, CannotRead>;
 
-FileReadResult ReadFile(std::filesystem::path const& path);
+/// <summary>
+/// Reads the whole content of the given file into a string allocated from the given memory
+/// resource.
+/// </summary>
+FileReadResult ReadFile(std::filesystem::path const& path,
+                        std::pmr::memory_resource*   resource = std::pmr::get_default_resource());
 
 /// <summary>
 /// Represents an error occurred when writing given strings to files.
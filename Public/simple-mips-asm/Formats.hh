@@ -4,10 +4,13 @@
 #ifndef SIMPLE_MIPS_ASM_CONSTANTS_HH
 #define SIMPLE_MIPS_ASM_CONSTANTS_HH
 
+#include <cstddef>
 #include <cstdint>
+#include <string_view>
 
 enum class RFormatFunction : uint8_t
 {
+    JALR = 0x09, // only for the relaxed jal, which is not in the instruction table
     ADDU = 0x21,
     SUBU = 0x23,
     AND  = 0x24,
@@ -65,4 +68,133 @@ enum class LAFormatType : uint8_t
     LA
 };
 
+// -------------------------------------- Instruction set -------------------------------------- //
+
+/// <summary>
+/// Represents the format of an instruction, which decides its operands and its encoding.
+/// </summary>
+enum class Format : uint8_t
+{
+    R,
+    JR,
+    SR,
+    I,
+    BI,
+    II,
+    OI,
+    J,
+    LA,
+};
+
+constexpr size_t NumFormats = static_cast<size_t>(Format::LA) + 1;
+
+/// <summary>
+/// Maps the type of the function or the operation of a format to the format.
+/// </summary>
+template <typename Code>
+struct FormatOfCode;
+
+template <>
+struct FormatOfCode<RFormatFunction>
+{
+    static constexpr Format value = Format::R;
+};
+
+template <>
+struct FormatOfCode<JRFormatFunction>
+{
+    static constexpr Format value = Format::JR;
+};
+
+template <>
+struct FormatOfCode<SRFormatFunction>
+{
+    static constexpr Format value = Format::SR;
+};
+
+template <>
+struct FormatOfCode<IFormatOperation>
+{
+    static constexpr Format value = Format::I;
+};
+
+template <>
+struct FormatOfCode<BIFormatOperation>
+{
+    static constexpr Format value = Format::BI;
+};
+
+template <>
+struct FormatOfCode<IIFormatOperation>
+{
+    static constexpr Format value = Format::II;
+};
+
+template <>
+struct FormatOfCode<OIFormatOperation>
+{
+    static constexpr Format value = Format::OI;
+};
+
+template <>
+struct FormatOfCode<JFormatOperation>
+{
+    static constexpr Format value = Format::J;
+};
+
+template <>
+struct FormatOfCode<LAFormatType>
+{
+    static constexpr Format value = Format::LA;
+};
+
+/// <summary>
+/// Describes an instruction. The operands and the encoding of an instruction are decided by its
+/// format, and <c>code</c> is the function or the operation of the format.
+/// </summary>
+struct InstructionDescriptor
+{
+    std::string_view mnemonic;
+    Format           format;
+    uint8_t          code;
+};
+
+template <typename Code>
+constexpr InstructionDescriptor MakeInstruction(std::string_view mnemonic, Code code) noexcept
+{
+    return { mnemonic, FormatOfCode<Code>::value, static_cast<uint8_t>(code) };
+}
+
+/// <summary>
+/// The instruction set. Both the parser and the encoder are generated from this table, so an
+/// instruction of an existing format is added with a single line, either with an enumerator
+/// above or as <c>{ mnemonic, format, code }</c>. Mnemonics are case-insensitive and must not be
+/// longer than 8 characters.
+/// </summary>
+inline constexpr InstructionDescriptor Instructions[] = {
+    MakeInstruction("addu", RFormatFunction::ADDU),
+    MakeInstruction("subu", RFormatFunction::SUBU),
+    MakeInstruction("and", RFormatFunction::AND),
+    MakeInstruction("or", RFormatFunction::OR),
+    MakeInstruction("nor", RFormatFunction::NOR),
+    MakeInstruction("sltu", RFormatFunction::SLTU),
+    MakeInstruction("jr", JRFormatFunction::JR),
+    MakeInstruction("sll", SRFormatFunction::SLL),
+    MakeInstruction("srl", SRFormatFunction::SRL),
+    MakeInstruction("addiu", IFormatOperation::ADDIU),
+    MakeInstruction("andi", IFormatOperation::ANDI),
+    MakeInstruction("ori", IFormatOperation::ORI),
+    MakeInstruction("sltiu", IFormatOperation::SLTIU),
+    MakeInstruction("beq", BIFormatOperation::BEQ),
+    MakeInstruction("bne", BIFormatOperation::BNE),
+    MakeInstruction("lui", IIFormatOperation::LUI),
+    MakeInstruction("lb", OIFormatOperation::LB),
+    MakeInstruction("lw", OIFormatOperation::LW),
+    MakeInstruction("sb", OIFormatOperation::SB),
+    MakeInstruction("sw", OIFormatOperation::SW),
+    MakeInstruction("j", JFormatOperation::J),
+    MakeInstruction("jal", JFormatOperation::JAL),
+    MakeInstruction("la", LAFormatType::LA),
+};
+
 #endif
\ No newline at end of file
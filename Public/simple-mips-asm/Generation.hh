@@ -4,10 +4,12 @@
 #ifndef SIMPLE_MIPS_ASM_GENERATOR_HH
 #define SIMPLE_MIPS_ASM_GENERATOR_HH
 
+#include <simple-mips-asm/Parallel.hh>
 #include <simple-mips-asm/Parsing.hh>
 
 #include <cstdint>
 #include <cstring>
+#include <memory_resource>
 #include <variant>
 #include <vector>
 
@@ -16,7 +18,6 @@ struct GenerationError
     enum class Type
     {
         UndefinedLabelName,
-        OperandIsLabelInTextSegment,
         LabelAlreadyDefined,
         BranchTargetTooFar,
         JumpAddressTooBig,
@@ -28,22 +29,179 @@ struct GenerationError
 
 struct CanGenerate
 {
-    std::vector<uint32_t> data;
-    std::vector<uint32_t> text;
+    std::pmr::vector<uint32_t> data;
+    std::pmr::vector<uint32_t> text;
 };
 
 struct CannotGenerate
 {
-    std::vector<GenerationError> errors;
+    std::pmr::vector<GenerationError> errors;
 };
 
 using GenerationResult = std::variant<CanGenerate, CannotGenerate>;
 
+/// <summary>
+/// Represents options of the generator.
+/// </summary>
+struct GenerationOptions
+{
+    /// <summary>
+    /// Replaces a branch or a jump in the text segment whose target is too far with a sequence
+    /// which reaches the target, instead of reporting <c>BranchTargetTooFar</c> or
+    /// <c>JumpAddressTooBig</c>. A branch becomes the inverted branch over a j, or over lui, ori
+    /// and jr if a j cannot reach the target either, and a jump becomes lui, ori and jr, or jalr
+    /// for a jal. The sequences overwrite $at.
+    /// </summary>
+    bool relaxBranches = true;
+
+    /// <summary>
+    /// Whether the target executes the instruction after a branch or a jump, which is in its delay
+    /// slot, before transferring control. A relaxed branch then keeps the instruction of its delay
+    /// slot after the sequence, and the inverted branch gets a nop in its own delay slot, so a
+    /// branch becomes 3 or 5 words instead of 2 or 4. Relaxed jumps are the same in both modes,
+    /// since jr and jalr have delay slots too.
+    /// </summary>
+    bool hasDelaySlots = false;
+};
+
 /// <summary>
 /// Generates machine code from the given array of fragments.
 /// </summary>
 /// <param name="fragments">the array of fragments</param>
+/// <param name="options">generator options</param>
+/// <param name="resource">the memory resource the result and temporaries are allocated from</param>
+/// <returns>generation result</returns>
+GenerationResult
+    GenerateCode(std::pmr::vector<Fragment> const& fragments,
+                 GenerationOptions const&          options  = {},
+                 std::pmr::memory_resource*        resource = std::pmr::get_default_resource());
+
+/// <summary>
+/// Generates machine code from the given array of fragments as the overload for
+/// <c>std::pmr::vector</c> does.
+/// </summary>
+GenerationResult
+    GenerateCode(std::vector<Fragment> const& fragments,
+                 GenerationOptions const&     options  = {},
+                 std::pmr::memory_resource*   resource = std::pmr::get_default_resource());
+
+/// <summary>
+/// Generates machine code from the given array of fragments using multiple threads. The layout of
+/// the fragments is found by the threads and combined in order, and then the threads encode their
+/// chunks directly into the segments. The result is the same as that of <c>GenerateCode</c>.
+/// </summary>
+/// <remarks>
+/// The threads encode each branch and jump in a word, and each la to a label defined before it. If
+/// a branch or a jump needs relaxation, an la refers to a label defined after it, or the code has
+/// an error, the code is generated by <c>GenerateCode</c> instead. This is found before any chunk
+/// is encoded, so the fallback costs only the layout pass.
+/// </remarks>
+/// <param name="fragments">the array of fragments</param>
+/// <param name="options">generator options</param>
+/// <param name="parallelOptions">the number of threads and the size of a chunk</param>
+/// <returns>generation result</returns>
+GenerationResult GenerateCodeParallel(std::pmr::vector<Fragment> const& fragments,
+                                      GenerationOptions const&          options         = {},
+                                      ParallelOptions const&            parallelOptions = {});
+
+// -------------------------------------- Encoded code ----------------------------------------- //
+
+/// <summary>
+/// Represents a segment of the output.
+/// </summary>
+enum class Segment : uint8_t
+{
+    Text,
+    Data,
+};
+
+/// <summary>
+/// Represents a part of encoded code which depends on the addresses of the labels.
+/// </summary>
+struct Fixup
+{
+    enum class Type : uint8_t
+    {
+        Label,       // defines the label at the word at the index
+        Branch,      // the offset of the branch at the index is the distance to the label
+        Jump,        // the target of the jump at the index is the address of the label
+        LoadAddress, // an la whose label may move; the word at the index is lui of the register
+    };
+
+    Type     type;
+    Segment  segment;
+    uint32_t index;
+    SymbolId target;
+    Range    range;
+};
+
+/// <summary>
+/// Represents code whose words are encoded except for the parts described by the fixups. The
+/// fixups are in the order of the fragments they come from.
+/// </summary>
+struct EncodedCode
+{
+    std::pmr::vector<uint32_t> data;
+    std::pmr::vector<uint32_t> text;
+    std::pmr::vector<Fixup>    fixups;
+
+    EncodedCode() = default;
+
+    /// <summary>
+    /// Creates empty code which allocates from the given memory resource.
+    /// </summary>
+    explicit EncodedCode(std::pmr::memory_resource* resource) :
+        data { resource }, text { resource }, fixups { resource }
+    {}
+};
+
+/// <summary>
+/// Represents the result of <c>EncodeCode</c>.
+/// </summary>
+struct EncodingResult
+{
+    std::pmr::vector<TokenizationError> tokenizationErrors;
+    std::pmr::vector<ParsingError>      parsingErrors;
+    SymbolTable                         symbols;
+    EncodedCode                         code;
+
+    EncodingResult() = default;
+
+    /// <summary>
+    /// Creates an empty result which allocates from the given memory resource.
+    /// </summary>
+    explicit EncodingResult(std::pmr::memory_resource* resource) :
+        tokenizationErrors { resource },
+        parsingErrors { resource },
+        symbols { resource },
+        code { resource }
+    {}
+};
+
+/// <summary>
+/// Parses the given code and encodes each fragment as soon as it is parsed, so the fragments are
+/// never stored. The errors are the same as those of <c>ParseCode</c>. The encoded code is
+/// meaningful only if there are no errors.
+/// </summary>
+/// <param name="code">the code to encode</param>
+/// <param name="tokenizationOptions">tokenizer options</param>
+/// <param name="options">parser options</param>
+/// <param name="resource">the memory resource the result is allocated from</param>
+/// <returns>errors, labels, and encoded code</returns>
+EncodingResult
+    EncodeCode(std::string_view           code,
+               TokenizationOptions const& tokenizationOptions = {},
+               ParseOptions const&        options             = {},
+               std::pmr::memory_resource* resource            = std::pmr::get_default_resource());
+
+/// <summary>
+/// Generates machine code by applying the fixups of the given encoded code. The result is the
+/// same as that of generating code from the fragments the encoded code comes from. The result and
+/// the temporaries are allocated from the memory resource of the given code.
+/// </summary>
+/// <param name="code">the encoded code</param>
+/// <param name="options">generator options</param>
 /// <returns>generation result</returns>
-GenerationResult GenerateCode(std::vector<Fragment> const& fragments);
+GenerationResult GenerateCode(EncodedCode code, GenerationOptions const& options = {});
 
 #endif
\ No newline at end of file
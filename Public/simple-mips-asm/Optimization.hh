@@ -0,0 +1,79 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_OPTIMIZATION_HH
+#define SIMPLE_MIPS_ASM_OPTIMIZATION_HH
+
+#include <simple-mips-asm/Parsing.hh>
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+/// <summary>
+/// Represents an instruction removed by the peephole optimizer.
+/// </summary>
+struct RemovedInstruction
+{
+    enum class Type
+    {
+        WriteToZero,    // the only effect is writing $0, e.g. sll $0, $0, 0
+        SelfAssignment, // writes a register with its own value, e.g. addiu $2, $2, 0
+        BranchToNext,   // a beq, a bne, or a j to the instruction after it
+    };
+
+    Type  type;
+    Range range;
+};
+
+/// <summary>
+/// Represents the result of <c>Optimize</c>.
+/// </summary>
+struct OptimizationReport
+{
+    std::pmr::vector<RemovedInstruction> removedInstructions;
+
+    OptimizationReport() = default;
+
+    /// <summary>
+    /// Creates an empty report which allocates from the given memory resource.
+    /// </summary>
+    explicit OptimizationReport(std::pmr::memory_resource* resource) :
+        removedInstructions { resource }
+    {}
+
+    /// <summary>
+    /// Returns the number of the removed instructions of the given type.
+    /// </summary>
+    size_t Count(RemovedInstruction::Type type) const noexcept;
+};
+
+/// <summary>
+/// Represents options of the peephole optimizer.
+/// </summary>
+struct OptimizationOptions
+{
+    /// <summary>
+    /// Whether the target has delay slots. The instruction after a branch or a jump is then kept
+    /// even if it does nothing, since removing it would move the next instruction into the delay
+    /// slot, and no branch or jump is removed as a branch to the next instruction.
+    /// </summary>
+    bool hasDelaySlots = false;
+};
+
+/// <summary>
+/// Removes the instructions which do nothing from the text segment of the given array of
+/// fragments. The instructions in the data segment are data words, and loads, stores, jal, jr, and
+/// an la of an undefined label, which the code generator reports, are always kept. The labels stay
+/// in place, so a label of a removed instruction refers to the instruction after it, and the
+/// labels are laid out again when the code is generated. A branch or a jump becomes a branch to
+/// the next instruction if the instructions between are removed, and then it is removed too.
+/// </summary>
+/// <param name="fragments">the array of fragments, which is modified in place</param>
+/// <param name="options">optimizer options</param>
+/// <returns>the removed instructions in order, which are allocated from the memory resource of
+/// the fragments</returns>
+OptimizationReport Optimize(std::pmr::vector<Fragment>& fragments,
+                            OptimizationOptions const&  options = {});
+
+#endif
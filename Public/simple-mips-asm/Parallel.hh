@@ -0,0 +1,27 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_PARALLEL_HH
+#define SIMPLE_MIPS_ASM_PARALLEL_HH
+
+#include <cstddef>
+
+/// <summary>
+/// Represents options of the parallel versions of the assembler stages.
+/// </summary>
+struct ParallelOptions
+{
+    /// <summary>
+    /// The number of threads to use. If zero, the number of hardware threads is used.
+    /// </summary>
+    size_t numThreads = 0;
+
+    /// <summary>
+    /// The approximate size of the work each thread takes at once, in the unit of the stage
+    /// (bytes for tokenization, tokens for parsing, and fragments for generation). If zero, a size
+    /// suitable for the input is chosen.
+    /// </summary>
+    size_t chunkSize = 0;
+};
+
+#endif
@@ -7,10 +7,65 @@
 #include <simple-mips-asm/Formats.hh>
 #include <simple-mips-asm/Tokenization.hh>
 
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
 #include <string_view>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
+// ------------------------------------------ Symbols ------------------------------------------ //
+
+/// <summary>
+/// Identifies a label name in a <c>SymbolTable</c>.
+/// </summary>
+using SymbolId = uint32_t;
+
+/// <summary>
+/// Assigns dense IDs to label names in the order they first appear, so that later phases can find
+/// information about a label by indexing an array with its ID. The names are views into the code
+/// and are compared case-sensitively.
+/// </summary>
+class SymbolTable
+{
+  public:
+    SymbolTable() = default;
+
+    /// <summary>
+    /// Creates an empty table which allocates from the given memory resource.
+    /// </summary>
+    explicit SymbolTable(std::pmr::memory_resource* resource) :
+        _names { resource }, _ids { resource }
+    {}
+
+  public:
+    /// <summary>
+    /// Returns the ID of the given name. If the name is new, it gets the next unused ID.
+    /// </summary>
+    SymbolId Intern(std::string_view name);
+
+    /// <summary>
+    /// Returns the name of the given ID, which must be less than <c>size()</c>.
+    /// </summary>
+    std::string_view GetName(SymbolId id) const noexcept
+    {
+        return _names[id];
+    }
+
+    /// <summary>
+    /// Returns the number of interned names.
+    /// </summary>
+    size_t size() const noexcept
+    {
+        return _names.size();
+    }
+
+  private:
+    std::pmr::vector<std::string_view>                  _names;
+    std::pmr::unordered_map<std::string_view, SymbolId> _ids;
+};
+
 // ----------------------------------- Fragment definitions ------------------------------------ //
 
 struct DataDirData
@@ -26,7 +81,7 @@ struct WordDirData
 
 struct LabelData
 {
-    std::string_view value;
+    SymbolId symbol;
 };
 
 struct RFormatData
@@ -64,7 +119,7 @@ struct BIFormatData
     BIFormatOperation operation;
     uint8_t           source;
     uint8_t           destination;
-    std::string_view  target;
+    SymbolId          target;
 };
 
 struct IIFormatData
@@ -85,14 +140,14 @@ struct OIFormatData
 struct JFormatData
 {
     JFormatOperation operation;
-    std::string_view target;
+    SymbolId         target;
 };
 
 struct LAFormatData
 {
     LAFormatType     type;
     uint8_t          destination;
-    std::string_view target;
+    SymbolId         target;
 };
 
 // clang-format off
@@ -133,20 +188,159 @@ struct ParsingError
 };
 
 /// <summary>
-/// Represents a parsing result.
+/// Represents options of the parser.
+/// </summary>
+struct ParseOptions
+{
+    /// <summary>
+    /// The maximum number of errors to report. The parser stops when the number of errors reaches
+    /// this value. If zero, the parser reads the whole input.
+    /// </summary>
+    size_t maxErrors = 0;
+};
+
+/// <summary>
+/// Represents a parsing result. The labels in the fragments refer to the names in
+/// <c>symbols</c>.
 /// </summary>
 struct ParseResult
 {
-    std::vector<Fragment>     fragments;
-    std::vector<ParsingError> errors;
+    std::pmr::vector<Fragment>     fragments;
+    std::pmr::vector<ParsingError> errors;
+    SymbolTable                    symbols;
+
+    ParseResult() = default;
+
+    /// <summary>
+    /// Creates an empty result which allocates from the given memory resource.
+    /// </summary>
+    explicit ParseResult(std::pmr::memory_resource* resource) :
+        fragments { resource }, errors { resource }, symbols { resource }
+    {}
 };
 
 /// <summary>
-/// Parses the given array of tokens. The given array's lifetime must be equal to or longer than
-/// that of fragments.
+/// Parses the given array of tokens. After an erroneous statement, the parser resumes at the next
+/// line. The given array's lifetime must be equal to or longer than that of fragments.
 /// </summary>
 /// <param name="tokens">the array of tokens to parse</param>
+/// <param name="options">parser options</param>
+/// <param name="resource">the memory resource the result is allocated from</param>
+/// <returns>parsing result</returns>
+ParseResult Parse(std::pmr::vector<Token> const& tokens,
+                  ParseOptions const&            options  = {},
+                  std::pmr::memory_resource*     resource = std::pmr::get_default_resource());
+
+/// <summary>
+/// Parses the given array of tokens as the overload for <c>std::pmr::vector</c> does.
+/// </summary>
+ParseResult Parse(std::vector<Token> const&  tokens,
+                  ParseOptions const&        options  = {},
+                  std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+/// <summary>
+/// Parses the given buffer of tokens. The lifetime of the code the given buffer refers to must be
+/// equal to or longer than that of fragments.
+/// </summary>
+/// <param name="tokens">the buffer of tokens to parse</param>
+/// <param name="options">parser options</param>
 /// <returns>parsing result</returns>
-ParseResult Parse(std::vector<Token> const& tokens);
+ParseResult Parse(TokenBuffer const& tokens, ParseOptions const& options = {});
+
+/// <summary>
+/// Parses the tokens of the given stream while the stream tokenizes the code line by line. The
+/// tokenization errors are available from the stream after parsing. The lifetime of the code the
+/// given stream refers to must be equal to or longer than that of fragments.
+/// </summary>
+/// <param name="tokens">the stream of tokens to parse</param>
+/// <param name="options">parser options</param>
+/// <returns>parsing result</returns>
+ParseResult Parse(TokenStream& tokens, ParseOptions const& options = {});
+
+/// <summary>
+/// Parses the given array of tokens using multiple threads. The array is split into chunks which
+/// end with NewLine tokens, and the chunks are parsed independently. The result is the same as
+/// that of <c>Parse</c>.
+/// </summary>
+/// <param name="tokens">the array of tokens to parse</param>
+/// <param name="options">parser options</param>
+/// <param name="parallelOptions">the number of threads and the number of tokens in a chunk</param>
+/// <returns>parsing result</returns>
+ParseResult ParseParallel(std::pmr::vector<Token> const& tokens,
+                          ParseOptions const&            options         = {},
+                          ParallelOptions const&         parallelOptions = {});
+
+/// <summary>
+/// Parses the given array of tokens using multiple threads as the overload for
+/// <c>std::pmr::vector</c> does.
+/// </summary>
+ParseResult ParseParallel(std::vector<Token> const& tokens,
+                          ParseOptions const&       options         = {},
+                          ParallelOptions const&    parallelOptions = {});
+
+/// <summary>
+/// Parses the given buffer of tokens using multiple threads. The result is the same as that of
+/// <c>Parse</c>.
+/// </summary>
+/// <param name="tokens">the buffer of tokens to parse</param>
+/// <param name="options">parser options</param>
+/// <param name="parallelOptions">the number of threads and the number of tokens in a chunk</param>
+/// <returns>parsing result</returns>
+ParseResult ParseParallel(TokenBuffer const&     tokens,
+                          ParseOptions const&    options         = {},
+                          ParallelOptions const& parallelOptions = {});
+
+/// <summary>
+/// Represents the result of <c>ParseCode</c>.
+/// </summary>
+struct CodeParseResult
+{
+    std::pmr::vector<TokenizationError> tokenizationErrors;
+    ParseResult                         parseResult;
+
+    CodeParseResult() = default;
+
+    /// <summary>
+    /// Creates an empty result which allocates from the given memory resource.
+    /// </summary>
+    explicit CodeParseResult(std::pmr::memory_resource* resource) :
+        tokenizationErrors { resource }, parseResult { resource }
+    {}
+};
+
+/// <summary>
+/// Parses the given code without storing its tokens. Well-formed lines are parsed directly from
+/// their bytes, and only the other lines are tokenized. The result is the same as that of
+/// <c>Tokenize</c> followed by <c>Parse</c>, except that the tokenization errors after the line
+/// where the number of parsing errors reached the limit are not reported. The given string's
+/// lifetime must be equal to or longer than that of fragments.
+/// </summary>
+/// <param name="code">the code to parse</param>
+/// <param name="tokenizationOptions">tokenizer options</param>
+/// <param name="options">parser options</param>
+/// <param name="resource">the memory resource the result is allocated from</param>
+/// <returns>tokenization errors and parsing result</returns>
+CodeParseResult
+    ParseCode(std::string_view           code,
+              TokenizationOptions const& tokenizationOptions = {},
+              ParseOptions const&        options             = {},
+              std::pmr::memory_resource* resource            = std::pmr::get_default_resource());
+
+/// <summary>
+/// Parses the given code as <c>ParseCode</c> does, calling the given function after each line.
+/// The function may take the fragments out of the result, so the fragments of the whole code do
+/// not have to be stored at once. The symbol table and the errors of the result are kept.
+/// </summary>
+/// <param name="code">the code to parse</param>
+/// <param name="tokenizationOptions">tokenizer options</param>
+/// <param name="options">parser options</param>
+/// <param name="onLine">the function called with the result after each line</param>
+/// <param name="resource">the memory resource the result is allocated from</param>
+/// <returns>tokenization errors and parsing result</returns>
+CodeParseResult ParseCode(std::string_view                         code,
+                          TokenizationOptions const&               tokenizationOptions,
+                          ParseOptions const&                      options,
+                          std::function<void(ParseResult&)> const& onLine,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 #endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_SCANNING_HH
+#define SIMPLE_MIPS_ASM_SCANNING_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#    include <intrin.h>
+#endif
+
+/// <summary>
+/// The number of bytes classified at once by a block scanner.
+/// </summary>
+constexpr size_t BlockSize = 64;
+
+/// <summary>
+/// Represents the structural bitmasks of a block of source code. The i-th bit of each mask
+/// corresponds to the i-th byte of the block.
+/// </summary>
+struct BlockMasks
+{
+    uint64_t newLines;       // \n
+    uint64_t delimiters;     // whitespaces (including \n) and .:$(),
+    uint64_t whitespaces;    // whitespaces except for \n
+    uint64_t digits;         // [0-9]
+    uint64_t hexDigits;      // [0-9a-fA-F]
+    uint64_t wordCharacters; // [0-9a-zA-Z_]
+    uint64_t hashes;         // #, which starts a comment
+};
+
+/// <summary>
+/// Returns the number of set bits of the given mask.
+/// </summary>
+inline uint32_t PopCount(uint64_t mask) noexcept
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    return static_cast<uint32_t>(__popcnt64(mask));
+#else
+    return static_cast<uint32_t>(__builtin_popcountll(mask));
+#endif
+}
+
+/// <summary>
+/// Returns the index of the lowest set bit of the given mask, which must not be zero.
+/// </summary>
+inline uint32_t CountTrailingZeros(uint64_t mask) noexcept
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(mask));
+#endif
+}
+
+/// <summary>
+/// Represents an implementation of the block scanner.
+/// </summary>
+enum class ScannerKind
+{
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+/// <summary>
+/// Classifies <c>BlockSize</c> bytes starting from the given pointer.
+/// </summary>
+using BlockScanner = BlockMasks (*)(char const* block) noexcept;
+
+/// <summary>
+/// Returns the fastest scanner implementation supported by the running processor.
+/// </summary>
+ScannerKind DetectScannerKind() noexcept;
+
+/// <summary>
+/// Returns the block scanner of the given kind. Falls back to the scalar implementation if the
+/// given kind is not available on this build.
+/// </summary>
+BlockScanner GetBlockScanner(ScannerKind kind) noexcept;
+
+/// <summary>
+/// Returns the block scanner chosen at runtime by <c>DetectScannerKind</c>.
+/// </summary>
+BlockScanner GetBlockScanner() noexcept;
+
+/// <summary>
+/// Classifies the given bytes, which can be shorter than <c>BlockSize</c>. Bytes after the end
+/// of the given string are treated as whitespaces.
+/// </summary>
+BlockMasks ScanPartialBlock(BlockScanner scanner, std::string_view bytes) noexcept;
+
+/// <summary>
+/// Counts the number of new line characters in the given string.
+/// </summary>
+size_t CountNewLines(std::string_view code) noexcept;
+
+#endif
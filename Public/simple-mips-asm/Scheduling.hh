@@ -0,0 +1,77 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_SCHEDULING_HH
+#define SIMPLE_MIPS_ASM_SCHEDULING_HH
+
+#include <simple-mips-asm/Parsing.hh>
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+/// <summary>
+/// Represents the result of <c>FillDelaySlots</c>.
+/// </summary>
+struct DelaySlotReport
+{
+    size_t numFilledSlots = 0; // the nops removed by moving an instruction into their slots
+    size_t numNopSlots    = 0; // the nops kept in delay slots
+};
+
+/// <summary>
+/// Fills the delay slots of the given array of fragments, which is for a target with delay slots.
+/// If a beq, a bne, a j, a jal, or a jr in the text segment is followed by a nop, the instruction
+/// before the branch or the jump is moved into its delay slot and the nop is removed. The
+/// instruction is not moved if it is labelled, if it is in the delay slot of another branch or
+/// jump, if it is an la, which may be more than one word, or if it writes a register the branch or
+/// the jump reads, or reads or writes $ra a jal writes. The data segment is left as it is.
+/// </summary>
+/// <param name="fragments">the array of fragments, which is modified in place</param>
+/// <returns>the numbers of the filled slots and of the nops kept</returns>
+DelaySlotReport FillDelaySlots(std::pmr::vector<Fragment>& fragments);
+
+/// <summary>
+/// Represents options of the load scheduler.
+/// </summary>
+struct SchedulingOptions
+{
+    /// <summary>
+    /// Whether the target has delay slots. The instruction in the delay slot of a branch or a jump
+    /// is then not moved.
+    /// </summary>
+    bool hasDelaySlots = false;
+};
+
+/// <summary>
+/// Represents the result of <c>ScheduleLoads</c>.
+/// </summary>
+struct LoadUseReport
+{
+    size_t numStallsBefore = 0;
+    size_t numStallsAfter  = 0;
+};
+
+/// <summary>
+/// Returns the number of the load-use stalls of the text segment of the given fragments on a
+/// 5-stage pipeline with forwarding, which is the number of the instructions reading a register
+/// the instruction right before them loads. Labels are skipped, so the stalls are counted on the
+/// fall-through paths.
+/// </summary>
+size_t CountLoadUseStalls(std::pmr::vector<Fragment> const& fragments) noexcept;
+
+/// <summary>
+/// Reorders the instructions of each basic block of the given fragments, so that fewer of them
+/// read the result of the load right before them. A basic block is a run of instructions in the
+/// text segment without labels, branches, jumps and directives, and it is list-scheduled along the
+/// dependencies between its instructions: an instruction stays after the ones which write the
+/// registers it reads or writes, or read the registers it writes, and memory accesses keep their
+/// order unless both are loads. A block is reordered only if the new order has fewer stalls.
+/// </summary>
+/// <param name="fragments">the array of fragments, which is modified in place</param>
+/// <param name="options">scheduler options</param>
+/// <returns>the numbers of the load-use stalls before and after scheduling</returns>
+LoadUseReport ScheduleLoads(std::pmr::vector<Fragment>& fragments,
+                            SchedulingOptions const&    options = {});
+
+#endif
@@ -4,6 +4,11 @@
 #ifndef SIMPLE_MIPS_ASM_TOKEN_HH
 #define SIMPLE_MIPS_ASM_TOKEN_HH
 
+#include <simple-mips-asm/Parallel.hh>
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <stdexcept>
 #include <string_view>
 #include <utility>
@@ -45,7 +50,7 @@ struct Token
     /// <summary>
     /// Represents the type of the given token
     /// </summary>
-    enum class Type
+    enum class Type : uint8_t
     {
         Dot,          // a single dot
         Colon,        // a single colon
@@ -80,10 +85,28 @@ struct TokenizationError
     Range range;
 };
 
+/// <summary>
+/// Represents options which change the token stream the tokenizer produces.
+/// </summary>
+struct TokenizationOptions
+{
+    /// <summary>
+    /// Drops Whitespace tokens. The parser accepts both streams, since whitespaces can appear
+    /// between any two tokens of a statement.
+    /// </summary>
+    bool elideWhitespaces = false;
+
+    /// <summary>
+    /// Skips a number sign and the following characters until the end of the line. Otherwise a
+    /// number sign is an invalid character.
+    /// </summary>
+    bool skipComments = false;
+};
+
 struct TokenizationResult
 {
-    std::vector<Token>             tokens;
-    std::vector<TokenizationError> errors;
+    std::pmr::vector<Token>             tokens;
+    std::pmr::vector<TokenizationError> errors;
 };
 
 /// <summary>
@@ -91,7 +114,107 @@ struct TokenizationResult
 /// that of tokens.
 /// </summary>
 /// <param name="code">the assembly code to tokenize</param>
+/// <param name="options">tokenization options</param>
+/// <param name="resource">the memory resource the result is allocated from</param>
+/// <returns>tokenization result</returns>
+TokenizationResult Tokenize(std::string_view           code,
+                            TokenizationOptions const& options  = {},
+                            std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+/// <summary>
+/// Tokenizes the given assembly code on multiple threads. The code is split into chunks at new
+/// lines, and the results of the chunks are concatenated in order, so the result is identical to
+/// that of <c>Tokenize</c>. The given string's lifetime must be equal to or longer than that of
+/// tokens.
+/// </summary>
+/// <param name="code">the assembly code to tokenize</param>
+/// <param name="options">tokenization options</param>
+/// <param name="parallelOptions">the number of threads and the chunk size in bytes</param>
+/// <returns>tokenization result</returns>
+TokenizationResult TokenizeParallel(std::string_view           code,
+                                    TokenizationOptions const& options         = {},
+                                    ParallelOptions const&     parallelOptions = {});
+
+/// <summary>
+/// Tokenizes the given assembly code on demand, one line at a time, so only the tokens of the
+/// current line are kept in memory. The given string's lifetime must be equal to or longer than
+/// that of the stream and the tokens.
+/// </summary>
+class TokenStream
+{
+  public:
+    explicit TokenStream(std::string_view code, TokenizationOptions const& options = {});
+    TokenStream(TokenStream&&) noexcept;
+    TokenStream& operator=(TokenStream&&) noexcept;
+    ~TokenStream();
+
+  public:
+    /// <summary>
+    /// Replaces the contents of the given array with the tokens of the next line, including the
+    /// trailing NewLine token if any.
+    /// </summary>
+    /// <param name="line">the array to store tokens</param>
+    /// <returns>false if there are no tokens left</returns>
+    bool NextLine(std::vector<Token>& line);
+
+    /// <summary>
+    /// Returns the errors occurred in the lines read so far.
+    /// </summary>
+    std::vector<TokenizationError> const& GetErrors() const noexcept;
+
+  private:
+    struct Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+/// <summary>
+/// Represents an array of tokens stored as separate arrays of types, offsets, and lengths.
+/// Positions are not stored; they are computed on demand from the offsets of the beginnings of
+/// the lines. Offsets are 32-bit, so the code must be smaller than 4 GiB.
+/// </summary>
+struct TokenBuffer
+{
+    std::string_view         code;
+    std::vector<Token::Type> types;
+    std::vector<uint32_t>    offsets;
+    std::vector<uint32_t>    lengths;
+    std::vector<uint32_t>    lineBegins;
+
+    size_t size() const noexcept
+    {
+        return types.size();
+    }
+
+    std::string_view GetValue(size_t index) const noexcept
+    {
+        return code.substr(offsets[index], lengths[index]);
+    }
+
+    /// <summary>
+    /// Returns the position of the byte at the given offset.
+    /// </summary>
+    Position GetPosition(uint32_t offset) const noexcept;
+
+    /// <summary>
+    /// Returns the range of the token at the given index.
+    /// </summary>
+    Range GetRange(size_t index) const noexcept;
+};
+
+struct CompactTokenizationResult
+{
+    TokenBuffer                    tokens;
+    std::vector<TokenizationError> errors;
+};
+
+/// <summary>
+/// Tokenizes the given assembly code into a <c>TokenBuffer</c>. The given string's lifetime must
+/// be equal to or longer than that of tokens.
+/// </summary>
+/// <param name="code">the assembly code to tokenize</param>
+/// <param name="options">tokenization options</param>
 /// <returns>tokenization result</returns>
-TokenizationResult Tokenize(std::string_view code);
+CompactTokenizationResult TokenizeCompact(std::string_view        code,
+                                          TokenizationOptions const& options = {});
 
 #endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <simple-mips-asm/Analysis.hh>
+
+#include "RegisterUse.hh"
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <variant>
+
+namespace
+{
+
+constexpr uint32_t None = std::numeric_limits<uint32_t>::max();
+
+/// <summary>
+/// Returns the target of the given fragment if it is a branch or a j, which makes a loop if the
+/// target is before it. A jal is a call, and the target of a jr is unknown.
+/// </summary>
+std::optional<SymbolId> FindLoopTarget(FragmentData const& data) noexcept
+{
+    if (auto branch = std::get_if<BIFormatData>(&data))
+        return branch->target;
+    auto jump = std::get_if<JFormatData>(&data);
+    if (jump && jump->operation == JFormatOperation::J)
+        return jump->target;
+    return std::nullopt;
+}
+
+/// <summary>
+/// Returns the given cycles weighted by the given loop depth, which saturates instead of
+/// overflowing.
+/// </summary>
+uint64_t Weigh(uint64_t cycles, uint32_t loopDepth, uint32_t loopWeight) noexcept
+{
+    constexpr uint64_t max = std::numeric_limits<uint64_t>::max();
+    for (uint32_t i = 0; i < loopDepth && cycles != 0; ++i)
+    {
+        if (cycles > max / std::max(loopWeight, 1u))
+            return max;
+        cycles *= loopWeight;
+    }
+    return cycles;
+}
+
+/// <summary>
+/// Returns the sum of the given cycles, which saturates instead of overflowing.
+/// </summary>
+uint64_t Add(uint64_t lhs, uint64_t rhs) noexcept
+{
+    return std::min(lhs, std::numeric_limits<uint64_t>::max() - rhs) + rhs;
+}
+
+/// <summary>
+/// Sorts the given estimates by their weighted cycles in descending order. The estimates with the
+/// same cost stay in the order of the code.
+/// </summary>
+template <typename Estimate>
+void SortByCost(std::pmr::vector<Estimate>& estimates)
+{
+    auto isHotter = [](Estimate const& lhs, Estimate const& rhs) {
+        return lhs.weightedCycles > rhs.weightedCycles;
+    };
+    std::stable_sort(estimates.begin(), estimates.end(), isHotter);
+}
+
+}
+
+CycleReport EstimateCycles(std::pmr::vector<Fragment> const& fragments, PipelineModel const& model)
+{
+    auto resource = fragments.get_allocator().resource();
+
+    uint32_t penalty = model.branchPenalty;
+    if (model.hasDelaySlots)
+        penalty = penalty == 0 ? 0 : penalty - 1;
+
+    CycleReport report { resource };
+    auto&       blocks = report.blocks;
+
+    // The first block after each label, the last block branching back to each label, and the
+    // labels whose code each block is in. Stacked labels have the same code, so the labels of a
+    // block are a range.
+    std::pmr::vector<uint32_t>                      labelBlocks { resource };
+    std::pmr::vector<uint32_t>                      loopEnds { resource };
+    std::pmr::vector<std::pair<uint32_t, uint32_t>> blockLabels { resource };
+
+    bool                          isInTextSegment = true;
+    bool                          isBlockOpen     = false;
+    bool                          isInDelaySlot   = false;
+    bool                          isAfterLabel    = false;
+    uint32_t                      loaded          = 0;
+    std::pair<uint32_t, uint32_t> labels { 0, 0 };
+
+    auto closeBlock = [&]() {
+        isBlockOpen   = false;
+        isInDelaySlot = false;
+    };
+
+    for (auto const& fragment : fragments)
+    {
+        auto const& data = fragment.data;
+        if (std::holds_alternative<DataDirData>(data) || std::holds_alternative<TextDirData>(data))
+        {
+            isInTextSegment = std::holds_alternative<TextDirData>(data);
+            loaded          = 0;
+            closeBlock();
+            continue;
+        }
+        if (!isInTextSegment)
+            continue;
+
+        if (auto label = std::get_if<LabelData>(&data))
+        {
+            if (labelBlocks.size() <= label->symbol)
+            {
+                labelBlocks.resize(label->symbol + 1, None);
+                loopEnds.resize(label->symbol + 1, None);
+            }
+            labelBlocks[label->symbol] = static_cast<uint32_t>(blocks.size());
+
+            if (!isAfterLabel)
+                labels.first = static_cast<uint32_t>(report.labels.size());
+            report.labels.push_back({ label->symbol, fragment.range, 0, 0 });
+            labels.second = static_cast<uint32_t>(report.labels.size());
+            isAfterLabel  = true;
+            closeBlock();
+            continue;
+        }
+        if (std::holds_alternative<WordDirData>(data))
+        {
+            loaded       = 0;
+            isAfterLabel = false;
+            closeBlock();
+            continue;
+        }
+
+        if (!isBlockOpen)
+        {
+            std::optional<SymbolId> label;
+            if (isAfterLabel)
+                label = report.labels.back().symbol;
+            blocks.push_back({ fragment.range, label, 0, 0, 0, 0, 0, 0 });
+            blockLabels.push_back(labels);
+            isBlockOpen = true;
+        }
+        isAfterLabel = false;
+
+        auto& block     = blocks.back();
+        block.range.end = fragment.range.end;
+
+        auto use = UseOf(data);
+        block.numInstructions += std::holds_alternative<LAFormatData>(data) ? 2 : 1;
+        if (use.reads & loaded)
+            block.numStallCycles += model.loadUseStall;
+        loaded = LoadedBy(use);
+
+        if (isInDelaySlot)
+        {
+            closeBlock();
+            continue;
+        }
+        if (!IsControlTransfer(data))
+            continue;
+
+        block.numPenaltyCycles += penalty;
+        if (auto target = FindLoopTarget(data))
+        {
+            // the label of a loop has been defined before the branch
+            auto blockIndex = static_cast<uint32_t>(blocks.size() - 1);
+            if (*target < labelBlocks.size() && labelBlocks[*target] <= blockIndex)
+                loopEnds[*target] = blockIndex;
+        }
+
+        if (model.hasDelaySlots)
+            isInDelaySlot = true;
+        else
+            closeBlock();
+    }
+
+    // the branches back to the same label make a single loop
+    std::pmr::vector<int32_t> loopDepthChanges(blocks.size() + 1, 0, resource);
+    for (size_t symbol = 0; symbol < loopEnds.size(); ++symbol)
+    {
+        // a label defined twice has been moved after its loop
+        if (loopEnds[symbol] == None || labelBlocks[symbol] > loopEnds[symbol])
+            continue;
+        ++loopDepthChanges[labelBlocks[symbol]];
+        --loopDepthChanges[loopEnds[symbol] + 1];
+    }
+
+    // the blocks are in the order of the code until they are sorted
+    int32_t loopDepth = 0;
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        loopDepth += loopDepthChanges[i];
+
+        auto& block          = blocks[i];
+        block.loopDepth      = static_cast<uint32_t>(loopDepth);
+        block.cycles         = uint64_t(block.numInstructions) + block.numStallCycles
+                               + block.numPenaltyCycles;
+        block.weightedCycles = Weigh(block.cycles, block.loopDepth, model.loopWeight);
+        report.totalCycles   = Add(report.totalCycles, block.cycles);
+
+        for (auto label = blockLabels[i].first; label != blockLabels[i].second; ++label)
+        {
+            auto& estimate          = report.labels[label];
+            estimate.cycles         = Add(estimate.cycles, block.cycles);
+            estimate.weightedCycles = Add(estimate.weightedCycles, block.weightedCycles);
+        }
+    }
+
+    SortByCost(blocks);
+    SortByCost(report.labels);
+    return report;
+}
@@ -0,0 +1,106 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <simple-mips-asm/Arena.hh>
+
+#include <algorithm>
+#include <cstdint>
+
+/// <summary>
+/// The header of an additional block, followed by the memory of the block.
+/// </summary>
+struct Arena::Block
+{
+    Block* next;
+    size_t size; // including the header
+};
+
+namespace
+{
+
+constexpr size_t BlockAlignment = alignof(std::max_align_t);
+
+inline std::byte* AlignUp(std::byte* pointer, size_t alignment) noexcept
+{
+    auto address = reinterpret_cast<uintptr_t>(pointer);
+    return pointer + ((alignment - address % alignment) % alignment);
+}
+
+}
+
+Arena::Arena(size_t size, std::pmr::memory_resource* upstream) :
+    _upstream { upstream },
+    _block { static_cast<std::byte*>(upstream->allocate(size, BlockAlignment)) },
+    _blockSize { size },
+    _current { _block },
+    _end { _block + size }
+{}
+
+Arena::~Arena()
+{
+    ReleaseOverflow();
+    _upstream->deallocate(_block, _blockSize, BlockAlignment);
+}
+
+void Arena::Reset()
+{
+    if (_overflow != nullptr)
+    {
+        size_t size = _blockSize + _overflowSize;
+        ReleaseOverflow();
+
+        _upstream->deallocate(_block, _blockSize, BlockAlignment);
+        _block     = static_cast<std::byte*>(_upstream->allocate(size, BlockAlignment));
+        _blockSize = size;
+    }
+
+    _current = _block;
+    _end     = _block + _blockSize;
+}
+
+size_t Arena::GetCapacity() const noexcept
+{
+    return _blockSize + _overflowSize;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment)
+{
+    std::byte* pointer = AlignUp(_current, alignment);
+    if (_end < pointer || static_cast<size_t>(_end - pointer) < bytes)
+    {
+        // each additional block is at least twice as large as the previous one
+        size_t size = std::max(bytes + alignment + sizeof(Block),
+                               _overflow != nullptr ? _overflow->size * 2 : _blockSize);
+
+        auto block  = static_cast<Block*>(_upstream->allocate(size, BlockAlignment));
+        block->next = _overflow;
+        block->size = size;
+        _overflow   = block;
+        _overflowSize += size;
+
+        _current = reinterpret_cast<std::byte*>(block + 1);
+        _end     = reinterpret_cast<std::byte*>(block) + size;
+        pointer  = AlignUp(_current, alignment);
+    }
+
+    _current = pointer + bytes;
+    return pointer;
+}
+
+void Arena::do_deallocate(void*, size_t, size_t) {}
+
+void Arena::ReleaseOverflow() noexcept
+{
+    while (_overflow != nullptr)
+    {
+        Block* next = _overflow->next;
+        _upstream->deallocate(_overflow, _overflow->size, BlockAlignment);
+        _overflow = next;
+    }
+    _overflowSize = 0;
+}
+
+bool Arena::do_is_equal(std::pmr::memory_resource const& other) const noexcept
+{
+    return this == &other;
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <simple-mips-asm/Assembler.hh>
+
+#include <utility>
+
+Assembler::Assembler(TokenizationOptions const& tokenizationOptions,
+                     ParseOptions const&        options,
+                     GenerationOptions const&   generationOptions,
+                     size_t                     arenaSize) :
+    _tokenizationOptions { tokenizationOptions },
+    _options { options },
+    _generationOptions { generationOptions },
+    _arena { arenaSize }
+{}
+
+AssemblyResult const& Assembler::Assemble(std::string_view code)
+{
+    // everything in the arena must be destroyed before it is rewound
+    _result.reset();
+    _arena.Reset();
+
+    _source.assign(code);
+    auto encodingResult = EncodeCode(_source, _tokenizationOptions, _options, &_arena);
+
+    auto& result              = _result.emplace(&_arena);
+    result.tokenizationErrors = std::move(encodingResult.tokenizationErrors);
+    result.parsingErrors      = std::move(encodingResult.parsingErrors);
+    result.symbols            = std::move(encodingResult.symbols);
+    if (result.tokenizationErrors.empty() && result.parsingErrors.empty())
+        result.generationResult = GenerateCode(std::move(encodingResult.code), _generationOptions);
+
+    return result;
+}
+
+std::string_view Assembler::GetSource() const noexcept
+{
+    return _source;
+}
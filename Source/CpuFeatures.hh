@@ -0,0 +1,52 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_CPU_FEATURES_HH
+#define SIMPLE_MIPS_ASM_CPU_FEATURES_HH
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define SIMPLE_MIPS_ASM_X64
+#    include <immintrin.h>
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#    endif
+#endif
+
+#if defined(__GNUC__)
+#    define SIMPLE_MIPS_ASM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#    define SIMPLE_MIPS_ASM_TARGET_AVX2
+#endif
+
+#ifdef SIMPLE_MIPS_ASM_X64
+
+/// <summary>
+/// Returns whether the running processor and the OS support AVX2.
+/// </summary>
+inline bool IsAVX2Supported() noexcept
+{
+#    if defined(__GNUC__)
+    return __builtin_cpu_supports("avx2");
+#    elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // OSXSAVE and AVX, then whether the OS saves the YMM registers
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return false;
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#    else
+    return false;
+#    endif
+}
+
+#endif
+
+#endif
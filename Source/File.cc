@@ -18,7 +18,7 @@ std::ostream& PrintWord(std::ostream& os, uint32_t word)
 
 }
 
-FileReadResult ReadFile(std::filesystem::path const& path)
+FileReadResult ReadFile(std::filesystem::path const& path, std::pmr::memory_resource* resource)
 {
     if (fs::is_directory(path))
         return CannotRead { FileReadError::Type::GivenPathIsDirectory };
@@ -30,7 +30,7 @@ FileReadResult ReadFile(std::filesystem::path const& path)
     ifs.seekg(0, std::ios::end);
     size_t fileSize = ifs.tellg();
 
-    std::string content(fileSize, ' ');
+    std::pmr::string content(fileSize, ' ', resource);
     ifs.seekg(0);
     ifs.read(std::addressof(content[0]), fileSize);
 
@@ -0,0 +1,454 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_FORMAT_TRAITS_HH
+#define SIMPLE_MIPS_ASM_FORMAT_TRAITS_HH
+
+#include <simple-mips-asm/Formats.hh>
+#include <simple-mips-asm/Parsing.hh>
+#include <simple-mips-asm/Tokenization.hh>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+constexpr uint8_t NumRegisters = 32;
+
+// ----------------------------------------  Operands ------------------------------------------ //
+
+/// <summary>
+/// A register written to the given member: Dollar + (Integer | Word)
+/// </summary>
+template <auto Member>
+struct RegisterOperand
+{};
+
+/// <summary>
+/// An integer in [Min, Max] written to the given member: Integer | HexInteger
+/// </summary>
+template <auto Member, int64_t Min, int64_t Max>
+struct IntegerOperand
+{};
+
+/// <summary>
+/// A label whose symbol ID is written to the given member: Word
+/// </summary>
+template <auto Member>
+struct LabelOperand
+{};
+
+/// <summary>
+/// A token which is only checked: Comma, BracketOpen, or BracketClose
+/// </summary>
+template <Token::Type Type, char Character>
+struct PunctuationOperand
+{};
+
+using Comma        = PunctuationOperand<Token::Type::Comma, ','>;
+using BracketOpen  = PunctuationOperand<Token::Type::BracketOpen, '('>;
+using BracketClose = PunctuationOperand<Token::Type::BracketClose, ')'>;
+
+template <auto Member>
+using ImmediateOperand = IntegerOperand<Member, -32768, 65535>;
+
+template <typename... Operands>
+struct OperandList
+{};
+
+// -----------------------------------------  Fields ------------------------------------------- //
+
+/// <summary>
+/// A field of an encoded instruction, <c>Width</c> bits from bit <c>Shift</c>, holding the given
+/// member.
+/// </summary>
+template <auto Member, uint32_t Shift, uint32_t Width>
+struct Field
+{
+    static constexpr auto     member = Member;
+    static constexpr uint32_t shift  = Shift;
+    static constexpr uint32_t width  = Width;
+    static constexpr uint32_t mask   = static_cast<uint32_t>((uint64_t(1) << Width) - 1) << Shift;
+};
+
+template <typename... Fields>
+struct FieldList
+{};
+
+// -----------------------------------------  Formats ------------------------------------------ //
+
+// Each format describes the data it is parsed into, the operands following its mnemonic in the
+// order they appear, and the fields of its encoding. `code` is the member holding the function or
+// the operation, and `fixupMask` is the part of the encoding which the generator fills in once the
+// label is resolved.
+
+template <Format F>
+struct FormatTraits;
+
+template <>
+struct FormatTraits<Format::R>
+{
+    using Data     = RFormatData;
+    using Operands = OperandList<RegisterOperand<&Data::destination>,
+                                 Comma,
+                                 RegisterOperand<&Data::source1>,
+                                 Comma,
+                                 RegisterOperand<&Data::source2>>;
+
+    // R: | 6 | src1: 5 | src2: 5 | dest: 5 | 5 | funct: 6 |
+    using Fields = FieldList<Field<&Data::source1, 21, 5>,
+                             Field<&Data::source2, 16, 5>,
+                             Field<&Data::destination, 11, 5>,
+                             Field<&Data::function, 0, 6>>;
+
+    static constexpr auto     code                = &Data::function;
+    static constexpr uint32_t fixupMask           = 0;
+    static constexpr bool     isPseudoInstruction = false;
+};
+
+template <>
+struct FormatTraits<Format::JR>
+{
+    using Data     = JRFormatData;
+    using Operands = OperandList<RegisterOperand<&Data::source>>;
+
+    // JR: | 6 | src: 5 | 15 | funct: 6 |
+    using Fields = FieldList<Field<&Data::source, 21, 5>, Field<&Data::function, 0, 6>>;
+
+    static constexpr auto     code                = &Data::function;
+    static constexpr uint32_t fixupMask           = 0;
+    static constexpr bool     isPseudoInstruction = false;
+};
+
+template <>
+struct FormatTraits<Format::SR>
+{
+    using Data     = SRFormatData;
+    using Operands = OperandList<RegisterOperand<&Data::destination>,
+                                 Comma,
+                                 RegisterOperand<&Data::source>,
+                                 Comma,
+                                 IntegerOperand<&Data::shiftAmount, 0, 31>>;
+
+    // SR: | 11 | src: 5 | dest: 5 | shamt: 5 | funct: 6 |
+    using Fields = FieldList<Field<&Data::source, 16, 5>,
+                             Field<&Data::destination, 11, 5>,
+                             Field<&Data::shiftAmount, 6, 5>,
+                             Field<&Data::function, 0, 6>>;
+
+    static constexpr auto     code                = &Data::function;
+    static constexpr uint32_t fixupMask           = 0;
+    static constexpr bool     isPseudoInstruction = false;
+};
+
+template <>
+struct FormatTraits<Format::I>
+{
+    using Data     = IFormatData;
+    using Operands = OperandList<RegisterOperand<&Data::destination>,
+                                 Comma,
+                                 RegisterOperand<&Data::source>,
+                                 Comma,
+                                 ImmediateOperand<&Data::immediate>>;
+
+    // I: | op: 6 | src: 5 | dest: 5 | imm: 16 |
+    using Fields = FieldList<Field<&Data::operation, 26, 6>,
+                             Field<&Data::source, 21, 5>,
+                             Field<&Data::destination, 16, 5>,
+                             Field<&Data::immediate, 0, 16>>;
+
+    static constexpr auto     code                = &Data::operation;
+    static constexpr uint32_t fixupMask           = 0;
+    static constexpr bool     isPseudoInstruction = false;
+};
+
+template <>
+struct FormatTraits<Format::BI>
+{
+    using Data     = BIFormatData;
+    using Operands = OperandList<RegisterOperand<&Data::source>,
+                                 Comma,
+                                 RegisterOperand<&Data::destination>,
+                                 Comma,
+                                 LabelOperand<&Data::target>>;
+
+    // BI: | op: 6 | src: 5 | dest: 5 | offset: 16 |
+    using Fields = FieldList<Field<&Data::operation, 26, 6>,
+                             Field<&Data::source, 21, 5>,
+                             Field<&Data::destination, 16, 5>>;
+
+    static constexpr auto     code                = &Data::operation;
+    static constexpr uint32_t fixupMask           = 0x0000FFFF;
+    static constexpr bool     isPseudoInstruction = false;
+};
+
+template <>
+struct FormatTraits<Format::II>
+{
+    using Data     = IIFormatData;
+    using Operands = OperandList<RegisterOperand<&Data::destination>,
+                                 Comma,
+                                 ImmediateOperand<&Data::immediate>>;
+
+    // II: | op: 6 | 5 | dest: 5 | imm: 16 |
+    using Fields = FieldList<Field<&Data::operation, 26, 6>,
+                             Field<&Data::destination, 16, 5>,
+                             Field<&Data::immediate, 0, 16>>;
+
+    static constexpr auto     code                = &Data::operation;
+    static constexpr uint32_t fixupMask           = 0;
+    static constexpr bool     isPseudoInstruction = false;
+};
+
+template <>
+struct FormatTraits<Format::OI>
+{
+    using Data     = OIFormatData;
+    using Operands = OperandList<RegisterOperand<&Data::operand2>,
+                                 Comma,
+                                 ImmediateOperand<&Data::offset>,
+                                 BracketOpen,
+                                 RegisterOperand<&Data::operand1>,
+                                 BracketClose>;
+
+    // OI: | op: 6 | opr1: 5 | opr2: 5 | offset: 16 |
+    using Fields = FieldList<Field<&Data::operation, 26, 6>,
+                             Field<&Data::operand1, 21, 5>,
+                             Field<&Data::operand2, 16, 5>,
+                             Field<&Data::offset, 0, 16>>;
+
+    static constexpr auto     code                = &Data::operation;
+    static constexpr uint32_t fixupMask           = 0;
+    static constexpr bool     isPseudoInstruction = false;
+};
+
+template <>
+struct FormatTraits<Format::J>
+{
+    using Data     = JFormatData;
+    using Operands = OperandList<LabelOperand<&Data::target>>;
+
+    // J: | op: 6 | target: 26 |
+    using Fields = FieldList<Field<&Data::operation, 26, 6>>;
+
+    static constexpr auto     code                = &Data::operation;
+    static constexpr uint32_t fixupMask           = 0x03FFFFFF;
+    static constexpr bool     isPseudoInstruction = false;
+};
+
+template <>
+struct FormatTraits<Format::LA>
+{
+    using Data     = LAFormatData;
+    using Operands = OperandList<RegisterOperand<&Data::destination>, //
+                                 Comma,
+                                 LabelOperand<&Data::target>>;
+
+    // expanded into lui and ori by the generator
+    using Fields = FieldList<>;
+
+    static constexpr auto     code                = &Data::type;
+    static constexpr uint32_t fixupMask           = 0;
+    static constexpr bool     isPseudoInstruction = true;
+};
+
+// -----------------------------------------  Helpers ------------------------------------------ //
+
+template <auto Left, auto Right>
+constexpr bool IsSameMember() noexcept
+{
+    if constexpr (std::is_same_v<decltype(Left), decltype(Right)>)
+        return Left == Right;
+    else
+        return false;
+}
+
+template <typename Data, size_t... Formats>
+constexpr Format FindFormatOfData(std::index_sequence<Formats...>) noexcept
+{
+    static_assert(
+        (0 + ... + std::is_same_v<typename FormatTraits<static_cast<Format>(Formats)>::Data, Data>)
+            == 1,
+        "every data type must belong to exactly one format");
+
+    Format format {};
+    ((std::is_same_v<typename FormatTraits<static_cast<Format>(Formats)>::Data, Data>
+          ? (format = static_cast<Format>(Formats), true)
+          : false)
+     || ...);
+    return format;
+}
+
+/// <summary>
+/// The format an instruction of the given data type belongs to.
+/// </summary>
+template <typename Data>
+constexpr Format FormatOfData = FindFormatOfData<Data>(std::make_index_sequence<NumFormats> {});
+
+/// <summary>
+/// The type of the given member of the given data type.
+/// </summary>
+template <typename Data, auto Member>
+using MemberType = std::remove_reference_t<decltype(std::declval<Data&>().*Member)>;
+
+template <typename Operand>
+constexpr bool IsLabel(Operand) noexcept
+{
+    return false;
+}
+
+template <auto Member>
+constexpr bool IsLabel(LabelOperand<Member>) noexcept
+{
+    return true;
+}
+
+/// <summary>
+/// Whether any of the given operands is a label.
+/// </summary>
+template <typename... Operands>
+constexpr bool HasLabel(OperandList<Operands...>) noexcept
+{
+    return (false || ... || IsLabel(Operands {}));
+}
+
+template <typename Data, typename Operand>
+void SetLabel(Data&, SymbolId, Operand) noexcept
+{}
+
+template <typename Data, auto Member>
+void SetLabel(Data& data, SymbolId symbol, LabelOperand<Member>) noexcept
+{
+    data.*Member = symbol;
+}
+
+/// <summary>
+/// Writes the given symbol to the members of the label operands.
+/// </summary>
+template <typename Data, typename... Operands>
+void SetLabel(Data& data, SymbolId symbol, OperandList<Operands...>) noexcept
+{
+    (SetLabel(data, symbol, Operands {}), ...);
+}
+
+/// <summary>
+/// Writes the given code to the member of the data holding the function or the operation.
+/// </summary>
+template <Format F>
+void SetCode(typename FormatTraits<F>::Data& data, uint8_t code) noexcept
+{
+    using Traits = FormatTraits<F>;
+    data.*Traits::code = static_cast<MemberType<typename Traits::Data, Traits::code>>(code);
+}
+
+/// <summary>
+/// Packs the given fields of the given data into an instruction.
+/// </summary>
+template <typename Data, typename... Fields>
+constexpr uint32_t EncodeFields(Data const& data, FieldList<Fields...>) noexcept
+{
+    // a value wider than its field is truncated
+    return (0u | ...
+            | ((static_cast<uint32_t>(data.*Fields::member) << Fields::shift) & Fields::mask));
+}
+
+// ------------------------------------------  Checks ------------------------------------------ //
+
+template <typename... Fields>
+constexpr bool AreFieldsDisjoint(uint32_t fixupMask, FieldList<Fields...>) noexcept
+{
+    // the sum of the masks is their union only if no two of them share a bit
+    uint64_t sum   = (uint64_t(fixupMask) + ... + uint64_t(Fields::mask));
+    uint64_t masks = (uint64_t(fixupMask) | ... | uint64_t(Fields::mask));
+    return (true && ... && (Fields::width != 0 && Fields::shift + Fields::width <= 32))
+           && sum == masks;
+}
+
+/// <summary>
+/// Returns the width of the field holding the given member, or zero if there is no such field.
+/// </summary>
+template <auto Member, typename... Fields>
+constexpr uint32_t WidthOf(FieldList<Fields...>) noexcept
+{
+    uint32_t width = 0;
+    ((width = IsSameMember<Member, Fields::member>() ? Fields::width : width), ...);
+    return width;
+}
+
+template <typename Fields, auto Member>
+constexpr bool FitsInField(Fields, RegisterOperand<Member>) noexcept
+{
+    return NumRegisters <= (uint64_t(1) << WidthOf<Member>(Fields {}));
+}
+
+template <typename Fields, auto Member, int64_t Min, int64_t Max>
+constexpr bool FitsInField(Fields, IntegerOperand<Member, Min, Max>) noexcept
+{
+    // a negative value is stored in two's complement
+    constexpr uint32_t width = WidthOf<Member>(Fields {});
+    return width != 0 && Min <= Max && Max < int64_t(1) << width
+           && -(int64_t(1) << (width - 1)) <= Min;
+}
+
+template <typename Fields, auto Member>
+constexpr bool FitsInField(Fields, LabelOperand<Member>) noexcept
+{
+    // a label is resolved by the generator
+    return WidthOf<Member>(Fields {}) == 0;
+}
+
+template <typename Fields, Token::Type Type, char Character>
+constexpr bool FitsInField(Fields, PunctuationOperand<Type, Character>) noexcept
+{
+    return true;
+}
+
+template <typename Fields, typename... Operands>
+constexpr bool DoOperandsFit(Fields, OperandList<Operands...>) noexcept
+{
+    return (true && ... && FitsInField(Fields {}, Operands {}));
+}
+
+/// <summary>
+/// Checks whether the codes of the instructions of the given format fit in the code field.
+/// </summary>
+template <Format F>
+constexpr bool DoCodesFit() noexcept
+{
+    using Traits = FormatTraits<F>;
+
+    uint32_t width = WidthOf<Traits::code>(typename Traits::Fields {});
+    for (auto const& instruction : Instructions)
+    {
+        if (instruction.format == F && (uint64_t(1) << width) <= instruction.code)
+            return false;
+    }
+    return true;
+}
+
+template <Format F>
+constexpr bool CheckFormat() noexcept
+{
+    using Traits = FormatTraits<F>;
+    using Fields = typename Traits::Fields;
+
+    static_assert(AreFieldsDisjoint(Traits::fixupMask, Fields {}),
+                  "the fields of a format must not overlap each other");
+    if constexpr (!Traits::isPseudoInstruction)
+    {
+        static_assert(DoOperandsFit(Fields {}, typename Traits::Operands {}),
+                      "every operand must fit in its field");
+        static_assert(DoCodesFit<F>(), "every code must fit in the code field");
+    }
+    return true;
+}
+
+template <size_t... Formats>
+constexpr bool CheckFormats(std::index_sequence<Formats...>) noexcept
+{
+    return (true && ... && CheckFormat<static_cast<Format>(Formats)>());
+}
+
+static_assert(CheckFormats(std::make_index_sequence<NumFormats> {}));
+
+#endif
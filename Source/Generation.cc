@@ -3,10 +3,15 @@
 
 #include <simple-mips-asm/Generation.hh>
 
+#include "FormatTraits.hh"
+#include "ParallelFor.hh"
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <iterator>
-#include <string_view>
-#include <unordered_map>
+#include <limits>
+#include <optional>
+#include <vector>
 
 namespace
 {
@@ -27,11 +32,6 @@ struct Address
     BaseType base;
     uint32_t offset;
 
-    constexpr void MoveToNext() noexcept
-    {
-        offset += 4;
-    }
-
     constexpr operator uint32_t() const noexcept
     {
         return static_cast<uint32_t>(base) + offset;
@@ -39,343 +39,1153 @@ struct Address
 };
 
 /// <summary>
-/// A key-value storage where the key is a label and the value is an address.
+/// Returns the base address of the given segment.
 /// </summary>
-using LabelTable = std::unordered_map<std::string_view, Address>;
+constexpr Address::BaseType BaseOf(Segment segment) noexcept
+{
+    return segment == Segment::Data ? Address::BaseType::DataSegment
+                                    : Address::BaseType::TextSegment;
+}
 
 /// <summary>
-/// Scanning result
+/// The addresses of the labels indexed by their symbol IDs. A label which is not defined has no
+/// address.
 /// </summary>
-struct ScanResult
+using LabelTable = std::pmr::vector<std::optional<Address>>;
+
+/// <summary>
+/// Returns the address of the given label, or nullptr if the label is not defined.
+/// </summary>
+inline Address const* FindLabel(LabelTable const& labelTable, SymbolId symbol) noexcept
 {
-    uint32_t                     numDataWords;
-    uint32_t                     numTextWords;
-    LabelTable                   labelTable;
-    std::vector<GenerationError> errors;
-};
+    if (symbol < labelTable.size() && labelTable[symbol])
+        return &*labelTable[symbol];
+    return nullptr;
+}
+
+/// <summary>
+/// Returns the offset of a branch at the given address to the given target, or nothing if the
+/// target is too far.
+/// </summary>
+inline std::optional<uint16_t> GetBranchOffset(uint32_t currentAddress, uint32_t targetAddress)
+{
+    auto difference = static_cast<int32_t>(targetAddress - currentAddress - 4) / 4;
+    if (difference < static_cast<int32_t>(std::numeric_limits<int16_t>::min())
+        || static_cast<int32_t>(std::numeric_limits<int16_t>::max()) < difference)
+        return std::nullopt;
+
+    return static_cast<uint16_t>(difference & 0xFFFF);
+}
+
+/// <summary>
+/// Returns the target field of a jump to the given address, or nothing if the address is too big.
+/// </summary>
+inline std::optional<uint32_t> GetJumpTarget(uint32_t targetAddress)
+{
+    targetAddress /= 4;
+    if (targetAddress >= (1 << 26))
+        return std::nullopt;
+
+    return targetAddress & 0x03FFFFFF;
+}
+
+// -----------------------------------------  Encoders ----------------------------------------- //
+
+inline uint32_t Encode(WordDirData const& data) noexcept
+{
+    return data.value;
+}
 
 /// <summary>
-/// Scans the given array of fragments, calculates the positions of the labels, number of words
-/// needed to store data segment and text segment.
+/// Encodes an instruction from the fields of its format. <c>fixup</c> is the resolved label of a
+/// branch or a jump.
 /// </summary>
-/// <param name="fragments">the array of fragments to scan</param>
-/// <returns>scanning result</returns>
-ScanResult ScanFragments(std::vector<Fragment> const& fragments)
+template <typename Data>
+inline uint32_t Encode(Data const& data, uint32_t fixup = 0) noexcept
 {
-    uint32_t                     numDataWords = 0;
-    uint32_t                     numTextWords = 0;
-    LabelTable                   labelTable;
-    std::vector<GenerationError> errors;
+    using Traits = FormatTraits<FormatOfData<Data>>;
+    static_assert(!Traits::isPseudoInstruction, "pseudo instructions are encoded separately");
+
+    return EncodeFields(data, typename Traits::Fields {}) | (fixup & Traits::fixupMask);
+}
 
-    Address::BaseType base                 = Address::BaseType::TextSegment;
-    uint32_t*         pNumWordsToIncrement = &numTextWords;
+/// <summary>
+/// Returns the number of the instructions of the shortest la of the given address, which is lui
+/// and ori, or one of them if the other half of the address is zero.
+/// </summary>
+constexpr uint32_t NumLoadAddressWords(uint32_t targetAddress) noexcept
+{
+    return (targetAddress >> 16) != 0 && (targetAddress & 0xFFFF) != 0 ? 2 : 1;
+}
+
+/// <summary>
+/// Writes an la of the given address with the given number of instructions, which is at least
+/// <c>NumLoadAddressWords(targetAddress)</c>, to the given output iterator.
+/// </summary>
+template <typename OutputIterator>
+inline OutputIterator Encode(LAFormatData const& data,
+                             uint32_t            targetAddress,
+                             uint32_t            numWords,
+                             OutputIterator      output)
+{
+    auto upper = static_cast<uint16_t>(targetAddress >> 16);
+    auto lower = static_cast<uint16_t>(targetAddress);
+    if (numWords == 1 && upper == 0)
+    {
+        *output++ = Encode(IFormatData { IFormatOperation::ORI, data.destination, 0, lower });
+        return output;
+    }
 
-    for (auto& fragment : fragments)
+    *output++ = Encode(IIFormatData { IIFormatOperation::LUI, data.destination, upper });
+    if (numWords == 2)
     {
-        if (std::holds_alternative<DataDirData>(fragment.data))
+        *output++ = Encode(
+            IFormatData { IFormatOperation::ORI, data.destination, data.destination, lower });
+    }
+    return output;
+}
+
+// --------------------------------------  Encoded code ---------------------------------------- //
+
+// Calls the Add overload of the type of the fragment. Unlike std::visit, the switch lets the
+// overloads be inlined.
+#define FRAGMENT_CASES(CASE)                                                                       \
+    CASE(0);                                                                                       \
+    CASE(1);                                                                                       \
+    CASE(2);                                                                                       \
+    CASE(3);                                                                                       \
+    CASE(4);                                                                                       \
+    CASE(5);                                                                                       \
+    CASE(6);                                                                                       \
+    CASE(7);                                                                                       \
+    CASE(8);                                                                                       \
+    CASE(9);                                                                                       \
+    CASE(10);                                                                                      \
+    CASE(11);                                                                                      \
+    CASE(12)
+#define ADD_FRAGMENT(Index)                                                                        \
+    case Index: return Add(*std::get_if<Index>(&fragment.data), fragment.range)
+
+static_assert(std::variant_size_v<FragmentData> == 13, "FRAGMENT_CASES must cover every type");
+
+/// <summary>
+/// Encodes fragments one at a time. The words of branches and jumps are completed later by
+/// <c>GenerateCode</c>, which also reports the errors. An la is encoded immediately if the address
+/// of its label is final, and otherwise is completed later too.
+/// </summary>
+class FragmentEncoder
+{
+  public:
+    explicit FragmentEncoder(EncodedCode& code) :
+        _code { code }, _labelTable { code.text.get_allocator().resource() }
+    {}
+
+  public:
+    void Add(Fragment const& fragment)
+    {
+        switch (fragment.data.index())
         {
-            base                 = Address::BaseType::DataSegment;
-            pNumWordsToIncrement = &numDataWords;
+            FRAGMENT_CASES(ADD_FRAGMENT);
         }
-        else if (std::holds_alternative<TextDirData>(fragment.data))
+    }
+
+  private:
+    void Add(DataDirData const&, Range)
+    {
+        _segment = Segment::Data;
+    }
+
+    void Add(TextDirData const&, Range)
+    {
+        _segment = Segment::Text;
+    }
+
+    void Add(LabelData const& data, Range range)
+    {
+        AddFixup(Fixup::Type::Label, NumWords(), data.symbol, range);
+
+        if (_labelTable.size() <= data.symbol)
+            _labelTable.resize(data.symbol + 1);
+        if (!_labelTable[data.symbol])
+            _labelTable[data.symbol] = Address { BaseOf(_segment), NumWords() * 4 };
+    }
+
+    void Add(BIFormatData const& data, Range range)
+    {
+        AddFixup(Fixup::Type::Branch, NumWords(), data.target, range);
+        AddWord(Encode(data));
+    }
+
+    void Add(JFormatData const& data, Range range)
+    {
+        AddFixup(Fixup::Type::Jump, NumWords(), data.target, range);
+        AddWord(Encode(data));
+    }
+
+    void Add(LAFormatData const& data, Range range)
+    {
+        // The text segment may have relaxed branches, and the data segment is final only until an
+        // la in it is completed later.
+        auto address = FindLabel(_labelTable, data.target);
+        if (address == nullptr || address->base != Address::BaseType::DataSegment
+            || !_isDataSegmentFinal)
         {
-            base                 = Address::BaseType::TextSegment;
-            pNumWordsToIncrement = &numTextWords;
+            if (_segment == Segment::Data)
+                _isDataSegmentFinal = false;
+
+            AddFixup(Fixup::Type::LoadAddress, NumWords(), data.target, range);
+            return AddWord(Encode(IIFormatData { IIFormatOperation::LUI, data.destination, 0 }));
         }
-        else if (std::holds_alternative<LabelData>(fragment.data))
-        {
-            auto labelData = std::get<LabelData>(fragment.data);
-            if (auto it = labelTable.find(labelData.value); it != labelTable.end())
-            {
-                errors.push_back(GenerationError {
-                    GenerationError::Type::LabelAlreadyDefined,
-                    fragment.range,
-                });
-                continue;
-            }
 
-            Address address { base, *pNumWordsToIncrement * 4 };
-            labelTable.insert(std::make_pair(labelData.value, address));
+        Encode(data, *address, NumLoadAddressWords(*address), std::back_inserter(Words()));
+    }
+
+    // words and instructions which do not refer to labels
+    template <typename Data>
+    void Add(Data const& data, Range)
+    {
+        AddWord(Encode(data));
+    }
+
+  private:
+    std::pmr::vector<uint32_t>& Words() noexcept
+    {
+        return _segment == Segment::Data ? _code.data : _code.text;
+    }
+
+    uint32_t NumWords() noexcept
+    {
+        return static_cast<uint32_t>(Words().size());
+    }
+
+    void AddWord(uint32_t word)
+    {
+        Words().push_back(word);
+    }
+
+    void AddFixup(Fixup::Type type, uint32_t index, SymbolId target, Range range)
+    {
+        _code.fixups.push_back({ type, _segment, index, target, range });
+    }
+
+  private:
+    EncodedCode& _code;
+    Segment      _segment            = Segment::Text;
+    bool         _isDataSegmentFinal = true;
+    LabelTable   _labelTable;
+};
+
+// ---------------------------------------  Generation ----------------------------------------- //
+
+/// <summary>
+/// Generates code from fragments in a single pass. A branch or a jump to a label defined before it
+/// is completed immediately, and one to a label defined later is recorded and completed by
+/// <c>Finish</c>. The generator fails on an la to a label defined later, whose size is not known,
+/// and on a branch or a jump which needs relaxation. It only detects errors, since they depend on
+/// each other; the errors are reported by <c>GenerateCode</c> with the fixups of
+/// <c>FragmentEncoder</c>.
+/// </summary>
+class CodeGenerator
+{
+  public:
+    explicit CodeGenerator(std::pmr::memory_resource* resource) :
+        _data { resource }, _text { resource }, _references { resource }, _labelTable { resource }
+    {}
+
+  public:
+    void Reserve(size_t numTextWords)
+    {
+        _text.reserve(numTextWords);
+    }
+
+    void Add(Fragment const& fragment)
+    {
+        switch (fragment.data.index())
+        {
+            FRAGMENT_CASES(ADD_FRAGMENT);
         }
-        else if (std::holds_alternative<LAFormatData>(fragment.data))
+    }
+
+    /// <summary>
+    /// Completes the references to the labels defined after them, and returns whether the code
+    /// can be generated.
+    /// </summary>
+    bool Finish()
+    {
+        if (_failed)
+            return false;
+
+        for (auto const& reference : _references)
         {
-            auto const& formatData = std::get<LAFormatData>(fragment.data);
-
-            // Assumptions:
-            // 1. .data segment always comes first
-            // 2. an address pointing to .text segment cannot be the operand of a LA format
-            // instruction.
-            if (auto it = labelTable.find(formatData.target);
-                it != labelTable.end() && it->second.base == Address::BaseType::DataSegment)
+            auto& words   = reference.segment == Segment::Data ? _data : _text;
+            auto  address = FindLabel(_labelTable, reference.target);
+            if (address == nullptr)
+                return false;
+
+            if (reference.type == Fixup::Type::Branch)
             {
-                if ((it->second.offset & 0xFFFF) == 0)
-                    *pNumWordsToIncrement += 1;
-                else
-                    *pNumWordsToIncrement += 2;
+                auto offset = GetBranchOffset(
+                    Address { BaseOf(reference.segment), reference.index * 4 }, *address);
+                if (!offset)
+                    return false;
+                words[reference.index] |= *offset & FormatTraits<Format::BI>::fixupMask;
             }
-            else
+            else /* if (reference.type == Fixup::Type::Jump) */
             {
-                // this contradicts to the assumption 2
-                errors.push_back(GenerationError {
-                    GenerationError::Type::OperandIsLabelInTextSegment,
-                    fragment.range,
-                });
-                continue;
+                auto target = GetJumpTarget(*address);
+                if (!target)
+                    return false;
+                words[reference.index] |= *target & FormatTraits<Format::J>::fixupMask;
             }
         }
-        else
-        {
-            *pNumWordsToIncrement += 1;
-        }
+
+        return true;
     }
 
-    return { numDataWords, numTextWords, std::move(labelTable), std::move(errors) };
-}
+    CanGenerate TakeCode() noexcept
+    {
+        return { std::move(_data), std::move(_text) };
+    }
 
-GenerationResult GenerateCodeInternal(std::vector<Fragment> const& fragments,
-                                      ScanResult const&            scanResult)
-{
-    std::vector<GenerationError> errors;
-    std::vector<uint32_t>        data;
-    std::vector<uint32_t>        text;
-    std::vector<uint32_t>*       pTarget = &text;
+  private:
+    void Add(DataDirData const&, Range)
+    {
+        _segment = Segment::Data;
+        _words   = &_data;
+    }
 
-    data.reserve(scanResult.numDataWords);
-    text.reserve(scanResult.numTextWords);
+    void Add(TextDirData const&, Range)
+    {
+        _segment = Segment::Text;
+        _words   = &_text;
+    }
 
-    LabelTable const& labelTable = scanResult.labelTable;
+    void Add(LabelData const& data, Range)
+    {
+        if (_labelTable.size() <= data.symbol)
+            _labelTable.resize(data.symbol + 1);
+        if (_labelTable[data.symbol])
+        {
+            _failed = true;
+            return;
+        }
 
-    Address  dataAddress { Address::BaseType::DataSegment, 0 };
-    Address  textAddress { Address::BaseType::TextSegment, 0 };
-    Address* pTargetAddress = &textAddress;
+        _labelTable[data.symbol] = CurrentAddress();
+    }
 
-    for (auto& fragment : fragments)
+    void Add(BIFormatData const& data, Range)
     {
-        if (std::holds_alternative<DataDirData>(fragment.data))
+        auto address = FindLabel(_labelTable, data.target);
+        if (address == nullptr)
         {
-            pTarget        = &data;
-            pTargetAddress = &dataAddress;
+            AddReference(Fixup::Type::Branch, data.target);
+            return AddWord(Encode(data));
         }
-        else if (std::holds_alternative<TextDirData>(fragment.data))
+
+        auto offset = GetBranchOffset(CurrentAddress(), *address);
+        _failed |= !offset;
+        AddWord(Encode(data, offset.value_or(0)));
+    }
+
+    void Add(JFormatData const& data, Range)
+    {
+        auto address = FindLabel(_labelTable, data.target);
+        if (address == nullptr)
         {
-            pTarget        = &text;
-            pTargetAddress = &textAddress;
+            AddReference(Fixup::Type::Jump, data.target);
+            return AddWord(Encode(data));
         }
-        else if (std::holds_alternative<WordDirData>(fragment.data))
+
+        auto target = GetJumpTarget(*address);
+        _failed |= !target;
+        AddWord(Encode(data, target.value_or(0)));
+    }
+
+    void Add(LAFormatData const& data, Range)
+    {
+        // the addresses of the labels before are final
+        auto address = FindLabel(_labelTable, data.target);
+        if (address == nullptr)
         {
-            auto wordDirData = std::get<WordDirData>(fragment.data);
-            pTarget->push_back(wordDirData.value);
-            pTargetAddress->MoveToNext();
+            _failed = true;
+            return;
         }
-        else if (std::holds_alternative<LabelData>(fragment.data))
-            /* Do nothing */;
-        else if (std::holds_alternative<RFormatData>(fragment.data))
-        {
-            auto data = std::get<RFormatData>(fragment.data);
 
-            // R: | 6 | src1: 5 | src2: 5 | dest: 5 | 5 | funct: 6 |
-            uint32_t instr = 0;
-            instr |= (static_cast<uint32_t>(data.source1 & 0b11111u) << 21);
-            instr |= (static_cast<uint32_t>(data.source2 & 0b11111u) << 16);
-            instr |= (static_cast<uint32_t>(data.destination & 0b11111u) << 11);
-            instr |= ((static_cast<uint32_t>(data.function) & 0b111111u) << 0);
+        Encode(data, *address, NumLoadAddressWords(*address), std::back_inserter(*_words));
+    }
 
-            pTarget->push_back(instr);
-            pTargetAddress->MoveToNext();
-        }
-        else if (std::holds_alternative<JRFormatData>(fragment.data))
-        {
-            auto data = std::get<JRFormatData>(fragment.data);
+    // words and instructions which do not refer to labels
+    template <typename Data>
+    void Add(Data const& data, Range)
+    {
+        AddWord(Encode(data));
+    }
 
-            // JR: | 6 | src: 5 | 15 | funct: 6 |
-            uint32_t instr = 0;
-            instr |= (static_cast<uint32_t>(data.source & 0b11111u) << 21);
-            instr |= ((static_cast<uint32_t>(data.function) & 0b111111u) << 0);
+  private:
+    Address CurrentAddress() const noexcept
+    {
+        return { BaseOf(_segment), static_cast<uint32_t>(_words->size()) * 4 };
+    }
 
-            pTarget->push_back(instr);
-            pTargetAddress->MoveToNext();
-        }
-        else if (std::holds_alternative<SRFormatData>(fragment.data))
-        {
-            auto data = std::get<SRFormatData>(fragment.data);
+    void AddWord(uint32_t word)
+    {
+        _words->push_back(word);
+    }
+
+    void AddReference(Fixup::Type type, SymbolId target)
+    {
+        _references.push_back({ type, _segment, static_cast<uint32_t>(_words->size()), target });
+    }
 
-            // SR: | 11 | src: 5 | dest: 5 | shamt: 5 | funct: 6 |
-            uint32_t instr = 0;
-            instr |= (static_cast<uint32_t>(data.source & 0b11111u) << 16);
-            instr |= (static_cast<uint32_t>(data.destination & 0b11111u) << 11);
-            instr |= (static_cast<uint32_t>(data.shiftAmount & 0b11111u) << 6);
-            instr |= ((static_cast<uint32_t>(data.function) & 0b111111u) << 0);
+  private:
+    /// <summary>
+    /// A branch or a jump to a label which is not defined yet.
+    /// </summary>
+    struct Reference
+    {
+        Fixup::Type type;
+        Segment     segment;
+        uint32_t    index;
+        SymbolId    target;
+    };
 
-            pTarget->push_back(instr);
-            pTargetAddress->MoveToNext();
+    std::pmr::vector<uint32_t>  _data;
+    std::pmr::vector<uint32_t>  _text;
+    std::pmr::vector<Reference> _references;
+    LabelTable                  _labelTable;
+    std::pmr::vector<uint32_t>* _words   = &_text;
+    Segment                     _segment = Segment::Text;
+    bool                        _failed  = false;
+};
+
+// ----------------------------------  Parallel generation ------------------------------------ //
+
+/// <summary>
+/// The minimum number of fragments a thread of <c>GenerateCodeParallel</c> takes at once, unless
+/// given.
+/// </summary>
+constexpr size_t MinChunkSize = 1 << 14;
+
+/// <summary>
+/// Represents a fragment which changes the layout of the fragments after it, which is a directive,
+/// a label, or an la. The state after the event is calculated with the state of the chunk.
+/// </summary>
+struct LayoutEvent
+{
+    uint32_t fragmentIndex;            // relative to the beginning of the chunk
+    uint32_t numWordsBefore;           // the number of words since the previous event in the chunk
+    Segment  segment  = Segment::Text; // the segment after the event
+    uint32_t numWords = 0;             // the number of the words of the segment after the event
+};
+
+/// <summary>
+/// Represents a branch or a jump in a chunk, which may not fit in a word. Its address is found
+/// from the state after the event before it.
+/// </summary>
+struct LayoutReference
+{
+    Fixup::Type type;
+    SymbolId    target;
+    uint32_t    numEventsBefore; // the number of the events before it in the chunk
+    uint32_t    numWordsBefore;  // the number of words since the previous event in the chunk
+};
+
+/// <summary>
+/// Represents the layout of a chunk of fragments. The events are found by the threads, and the
+/// state at the beginning of the chunk is then calculated from the events of the previous chunks.
+/// </summary>
+struct ChunkLayout
+{
+    std::vector<LayoutEvent>     events;
+    std::vector<LayoutReference> references;
+    uint32_t                     numTrailingWords = 0;
+
+    Segment  segment     = Segment::Text;
+    uint32_t numWords[2] = {};
+};
+
+/// <summary>
+/// Finds the layout events, and the branches and the jumps of the given range of fragments. Every
+/// fragment which is not an event is one word.
+/// </summary>
+void FindLayoutEvents(Fragment const* begin, Fragment const* end, ChunkLayout& layout)
+{
+    uint32_t numWords = 0;
+    for (auto fragment = begin; fragment != end; ++fragment)
+    {
+        auto const& data = fragment->data;
+        if (std::holds_alternative<DataDirData>(data) || std::holds_alternative<TextDirData>(data)
+            || std::holds_alternative<LabelData>(data)
+            || std::holds_alternative<LAFormatData>(data))
+        {
+            layout.events.push_back({ static_cast<uint32_t>(fragment - begin), numWords });
+            numWords = 0;
         }
-        else if (std::holds_alternative<IFormatData>(fragment.data))
+        else
         {
-            auto data = std::get<IFormatData>(fragment.data);
+            auto numEvents = static_cast<uint32_t>(layout.events.size());
+            auto& references = layout.references;
+            if (auto branch = std::get_if<BIFormatData>(&data))
+                references.push_back({ Fixup::Type::Branch, branch->target, numEvents, numWords });
+            else if (auto jump = std::get_if<JFormatData>(&data))
+                references.push_back({ Fixup::Type::Jump, jump->target, numEvents, numWords });
+            numWords += 1;
+        }
+    }
+    layout.numTrailingWords = numWords;
+}
 
-            // I: | op: 6 | src: 5 | dest: 5 | imm: 16 |
-            uint32_t instr = 0;
-            instr |= ((static_cast<uint32_t>(data.operation) & 0b111111u) << 26);
-            instr |= (static_cast<uint32_t>(data.source & 0b11111u) << 21);
-            instr |= (static_cast<uint32_t>(data.destination & 0b11111u) << 16);
-            instr |= (static_cast<uint32_t>(data.immediate) << 0);
+/// <summary>
+/// Encodes a chunk of fragments into the words of the segments, starting from the state at the
+/// beginning of the chunk. The labels must be laid out before.
+/// </summary>
+class ChunkEncoder
+{
+  public:
+    ChunkEncoder(ChunkLayout const& layout, uint32_t* words[2], LabelTable const& labelTable) :
+        _labelTable { labelTable },
+        _words { words[0], words[1] },
+        _segment { layout.segment },
+        _numWords { layout.numWords[0], layout.numWords[1] }
+    {}
 
-            pTarget->push_back(instr);
-            pTargetAddress->MoveToNext();
-        }
-        else if (std::holds_alternative<BIFormatData>(fragment.data))
+  public:
+    void Add(Fragment const& fragment)
+    {
+        switch (fragment.data.index())
         {
-            auto const& data = std::get<BIFormatData>(fragment.data);
+            FRAGMENT_CASES(ADD_FRAGMENT);
+        }
+    }
 
-            auto it = labelTable.find(data.target);
-            if (it == labelTable.end())
-            {
-                errors.push_back(GenerationError {
-                    GenerationError::Type::UndefinedLabelName,
-                    fragment.range,
-                });
-                continue;
-            }
+  private:
+    void Add(DataDirData const&, Range)
+    {
+        _segment = Segment::Data;
+    }
+
+    void Add(TextDirData const&, Range)
+    {
+        _segment = Segment::Text;
+    }
+
+    void Add(LabelData const&, Range) {}
+
+    // the labels of branches and jumps are checked before the chunks are encoded
+    void Add(BIFormatData const& data, Range)
+    {
+        auto address = FindLabel(_labelTable, data.target);
+        AddWord(Encode(data, *GetBranchOffset(CurrentAddress(), *address)));
+    }
+
+    void Add(JFormatData const& data, Range)
+    {
+        auto address = FindLabel(_labelTable, data.target);
+        AddWord(Encode(data, *GetJumpTarget(*address)));
+    }
+
+    void Add(LAFormatData const& data, Range)
+    {
+        // the label is checked when the labels are laid out
+        auto address  = FindLabel(_labelTable, data.target);
+        auto numWords = NumLoadAddressWords(*address);
+        Encode(data, *address, numWords, _words[static_cast<size_t>(_segment)] + NumWords());
+        NumWords() += numWords;
+    }
+
+    // words and instructions which do not refer to labels
+    template <typename Data>
+    void Add(Data const& data, Range)
+    {
+        AddWord(Encode(data));
+    }
+
+  private:
+    uint32_t& NumWords() noexcept
+    {
+        return _numWords[static_cast<size_t>(_segment)];
+    }
+
+    Address CurrentAddress() noexcept
+    {
+        return { BaseOf(_segment), NumWords() * 4 };
+    }
+
+    void AddWord(uint32_t word)
+    {
+        _words[static_cast<size_t>(_segment)][NumWords()++] = word;
+    }
+
+  private:
+    LabelTable const& _labelTable;
+    uint32_t*         _words[2];
+    Segment           _segment;
+    uint32_t          _numWords[2];
+};
+
+/// <summary>
+/// Lays out the labels by visiting the events of the chunks in order, and calculates the state at
+/// the beginning of each chunk, the state after each event, and the number of words of each
+/// segment. Returns false if a label is defined twice or an la refers to a label which is not
+/// defined before it.
+/// </summary>
+bool LayOutChunks(std::pmr::vector<Fragment> const& fragments,
+                  std::vector<size_t> const&        boundaries,
+                  std::vector<ChunkLayout>&         layouts,
+                  LabelTable&                       labelTable,
+                  uint32_t (&numWords)[2])
+{
+    Segment segment = Segment::Text;
 
-            uint32_t currentAddress = *pTargetAddress;
-            uint32_t targetAddress  = it->second;
+    auto addWords = [&](uint32_t count) { numWords[static_cast<size_t>(segment)] += count; };
 
-            auto difference = static_cast<int32_t>(targetAddress - currentAddress - 4) / 4;
-            if (difference < static_cast<int32_t>(std::numeric_limits<int16_t>::min())
-                || static_cast<int32_t>(std::numeric_limits<int16_t>::max()) < difference)
+    for (size_t i = 0; i < layouts.size(); ++i)
+    {
+        auto& layout       = layouts[i];
+        layout.segment     = segment;
+        layout.numWords[0] = numWords[0];
+        layout.numWords[1] = numWords[1];
+
+        for (auto& event : layout.events)
+        {
+            addWords(event.numWordsBefore);
+
+            auto const& data = fragments[boundaries[i] + event.fragmentIndex].data;
+            if (std::holds_alternative<DataDirData>(data))
+                segment = Segment::Data;
+            else if (std::holds_alternative<TextDirData>(data))
+                segment = Segment::Text;
+            else if (auto label = std::get_if<LabelData>(&data))
             {
-                errors.push_back(GenerationError {
-                    GenerationError::Type::BranchTargetTooFar,
-                    fragment.range,
-                });
-                continue;
+                if (labelTable.size() <= label->symbol)
+                    labelTable.resize(label->symbol + 1);
+                if (labelTable[label->symbol])
+                    return false;
+
+                auto offset = numWords[static_cast<size_t>(segment)] * 4;
+                labelTable[label->symbol] = Address { BaseOf(segment), offset };
             }
+            else /* if (std::holds_alternative<LAFormatData>(data)) */
+            {
+                auto address = FindLabel(labelTable, std::get<LAFormatData>(data).target);
+                if (address == nullptr)
+                    return false;
 
-            // BI: | op: 6 | src: 5 | dest: 5 | imm: 16 |
-            uint32_t instr = 0;
-            instr |= ((static_cast<uint32_t>(data.operation) & 0b111111u) << 26);
-            instr |= (static_cast<uint32_t>(data.source & 0b11111u) << 21);
-            instr |= (static_cast<uint32_t>(data.destination & 0b11111u) << 16);
-            instr |= ((static_cast<uint32_t>(difference & 0xFFFF)) << 0);
+                addWords(NumLoadAddressWords(*address));
+            }
 
-            pTarget->push_back(instr);
-            pTargetAddress->MoveToNext();
+            event.segment  = segment;
+            event.numWords = numWords[static_cast<size_t>(segment)];
         }
-        else if (std::holds_alternative<IIFormatData>(fragment.data))
+
+        addWords(layout.numTrailingWords);
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Returns whether every branch and jump of the given laid out chunk refers to a label which is
+/// defined and fits in a word, which means the chunk can be encoded without relaxation.
+/// </summary>
+bool CheckReferences(ChunkLayout const& layout, LabelTable const& labelTable)
+{
+    for (auto const& reference : layout.references)
+    {
+        auto segment  = layout.segment;
+        auto numWords = layout.numWords[static_cast<size_t>(segment)];
+        if (reference.numEventsBefore != 0)
         {
-            auto data = std::get<IIFormatData>(fragment.data);
+            auto const& event = layout.events[reference.numEventsBefore - 1];
+            segment           = event.segment;
+            numWords          = event.numWords;
+        }
+
+        Address address { BaseOf(segment), (numWords + reference.numWordsBefore) * 4 };
+        auto    target = FindLabel(labelTable, reference.target);
+        if (target == nullptr)
+            return false;
+        if (reference.type == Fixup::Type::Branch ? !GetBranchOffset(address, *target)
+                                                  : !GetJumpTarget(*target))
+            return false;
+    }
+    return true;
+}
+
+// ----------------------------------------  Layout ------------------------------------------- //
 
-            // II: | op: 6 | 5 | dest: 5 | imm: 16 |
-            uint32_t instr = 0;
-            instr |= ((static_cast<uint32_t>(data.operation) & 0b111111) << 26);
-            instr |= (static_cast<uint32_t>(data.destination & 0b11111) << 16);
-            instr |= (static_cast<uint32_t>(data.immediate) << 0);
+/// <summary>
+/// The register relaxed branches and jumps load their targets into, which is $at.
+/// </summary>
+constexpr uint8_t AssemblerTemporary = 1;
 
-            pTarget->push_back(instr);
-            pTargetAddress->MoveToNext();
+/// <summary>
+/// The register jal writes the return address to, which is $ra.
+/// </summary>
+constexpr uint8_t ReturnAddress = 31;
+
+/// <summary>
+/// Represents a fixup of encoded code which refers to a label, and its place in the laid out code.
+/// The fixup has one word in the encoded code, which is replaced with <c>numWords</c> words.
+/// </summary>
+struct Placement
+{
+    Fixup const* fixup;
+    uint32_t     index;       // the index of the first word in the laid out segment
+    uint32_t     numWords;    // only grows while the labels are laid out
+    bool         isResizable; // false for a branch or a jump which is not relaxed
+};
+
+/// <summary>
+/// Returns the number of the words a fixup needs at the given address to refer to the given
+/// target. A relaxed branch is the inverted branch over a j (2 words), or over lui, ori and jr (4
+/// words), and a relaxed jump is lui, ori and jr or jalr (3 words). With delay slots, the inverted
+/// branch is followed by a nop, which adds a word to a relaxed branch.
+/// </summary>
+inline uint32_t
+    NumWordsOf(Fixup::Type type, Address address, uint32_t targetAddress, bool hasDelaySlots)
+{
+    switch (type)
+    {
+    case Fixup::Type::Branch:
+        if (GetBranchOffset(address, targetAddress))
+            return 1;
+        return (GetJumpTarget(targetAddress) ? 2 : 4) + (hasDelaySlots ? 1 : 0);
+    case Fixup::Type::Jump: return GetJumpTarget(targetAddress) ? 1 : 3;
+    default: return NumLoadAddressWords(targetAddress);
+    }
+}
+
+/// <summary>
+/// Writes the words of the given placement to the given output iterator. <c>word</c> is the word
+/// of the fixup in the encoded code, which is the instruction without its label, or lui of the
+/// destination for an la. The word may have been written with another layout before.
+/// </summary>
+/// <remarks>
+/// With delay slots, the instruction after a relaxed branch stays after the sequence and is in the
+/// delay slot of the j, or of the jr. If the inverted branch is taken, which means the original
+/// branch is not, it lands on that instruction, and the nop in its own delay slot keeps the
+/// instruction from running twice.
+/// </remarks>
+template <typename OutputIterator>
+OutputIterator Write(Placement const& placement,
+                     uint32_t         word,
+                     uint32_t         targetAddress,
+                     bool             hasDelaySlots,
+                     OutputIterator   output)
+{
+    auto    type = placement.fixup->type;
+    Address address { BaseOf(placement.fixup->segment), placement.index * 4 };
+
+    if (type == Fixup::Type::LoadAddress)
+    {
+        LAFormatData data { LAFormatType::LA, static_cast<uint8_t>((word >> 16) & 0x1F), 0 };
+        return Encode(data, targetAddress, placement.numWords, output);
+    }
+
+    if (placement.numWords == 1)
+    {
+        if (type == Fixup::Type::Branch)
+        {
+            auto mask   = FormatTraits<Format::BI>::fixupMask;
+            auto offset = *GetBranchOffset(address, targetAddress);
+            *output++   = (word & ~mask) | (offset & mask);
         }
-        else if (std::holds_alternative<OIFormatData>(fragment.data))
+        else
         {
-            auto data = std::get<OIFormatData>(fragment.data);
+            auto mask   = FormatTraits<Format::J>::fixupMask;
+            auto target = *GetJumpTarget(targetAddress);
+            *output++   = (word & ~mask) | (target & mask);
+        }
+        return output;
+    }
 
-            // OI: | op: 6 | opr1: 5 | opr2: 5 | offset: 16 |
-            uint32_t instr = 0;
-            instr |= ((static_cast<uint32_t>(data.operation) & 0b111111) << 26);
-            instr |= (static_cast<uint32_t>(data.operand1 & 0b11111) << 21);
-            instr |= (static_cast<uint32_t>(data.operand2 & 0b11111) << 16);
-            instr |= (static_cast<uint32_t>(data.offset) << 0);
+    if (type == Fixup::Type::Branch)
+    {
+        // the inverted branch skips the rest of the sequence
+        auto operation   = static_cast<BIFormatOperation>(word >> 26);
+        auto source      = static_cast<uint8_t>((word >> 21) & 0x1F);
+        auto destination = static_cast<uint8_t>((word >> 16) & 0x1F);
+        auto inverted    = operation == BIFormatOperation::BEQ ? BIFormatOperation::BNE
+                                                               : BIFormatOperation::BEQ;
 
-            pTarget->push_back(instr);
-            pTargetAddress->MoveToNext();
-        }
-        else if (std::holds_alternative<JFormatData>(fragment.data))
+        BIFormatData branch { inverted, source, destination, 0 };
+        *output++ = Encode(branch, placement.numWords - 1);
+        if (hasDelaySlots)
+            *output++ = Encode(SRFormatData { SRFormatFunction::SLL, 0, 0, 0 });
+
+        if (placement.numWords == (hasDelaySlots ? 3 : 2))
         {
-            auto const& data = std::get<JFormatData>(fragment.data);
+            auto jumpTarget = *GetJumpTarget(targetAddress);
+            *output++       = Encode(JFormatData { JFormatOperation::J, 0 }, jumpTarget);
+            return output;
+        }
+    }
 
-            auto it = labelTable.find(data.target);
-            if (it == labelTable.end())
-            {
-                errors.push_back(GenerationError {
-                    GenerationError::Type::UndefinedLabelName,
-                    fragment.range,
-                });
-                continue;
-            }
+    auto upper = static_cast<uint16_t>(targetAddress >> 16);
+    auto lower = static_cast<uint16_t>(targetAddress);
+    *output++  = Encode(IIFormatData { IIFormatOperation::LUI, AssemblerTemporary, upper });
+    *output++  = Encode(
+        IFormatData { IFormatOperation::ORI, AssemblerTemporary, AssemblerTemporary, lower });
+
+    if (type == Fixup::Type::Jump
+        && static_cast<JFormatOperation>(word >> 26) == JFormatOperation::JAL)
+    {
+        // jalr $ra, $at
+        *output++ = Encode(
+            RFormatData { RFormatFunction::JALR, ReturnAddress, AssemblerTemporary, 0 });
+    }
+    else
+    {
+        *output++ = Encode(JRFormatData { JRFormatFunction::JR, AssemblerTemporary });
+    }
+    return output;
+}
+
+/// <summary>
+/// Lays out the labels of the given encoded code with the sizes of the given placements, and fills
+/// the given table with their addresses. Resizing a placement moves the labels after it, which may
+/// change the sizes of other placements, so the sizes are calculated again until none of them
+/// changes. This ends since a size only grows. Returns the number of the words added to each
+/// segment.
+/// </summary>
+std::array<uint32_t, 2> LayOut(EncodedCode const&            code,
+                               std::pmr::vector<Placement>& placements,
+                               LabelTable&                  labelTable,
+                               GenerationOptions const&     options)
+{
+    std::array<uint32_t, 2> numExtraWords {};
+    for (bool changed = true; changed;)
+    {
+        numExtraWords  = {};
+        auto placement = placements.begin();
+        for (auto const& fixup : code.fixups)
+        {
+            auto& numExtra = numExtraWords[static_cast<size_t>(fixup.segment)];
 
-            uint32_t targetAddress = it->second / 4;
-            if (targetAddress >= (1 << 26))
+            // a label defined twice has been reported
+            if (fixup.type == Fixup::Type::Label)
             {
-                errors.push_back(GenerationError {
-                    GenerationError::Type::JumpAddressTooBig,
-                    fragment.range,
-                });
+                labelTable[fixup.target]
+                    = Address { BaseOf(fixup.segment), (fixup.index + numExtra) * 4 };
                 continue;
             }
 
-            // J: | op: 6 | target: 26 |
-            uint32_t instr = 0;
-            instr |= ((static_cast<uint32_t>(data.operation) & 0b111111) << 26);
-            instr |= ((targetAddress & 0x03FFFFFF) << 0);
-
-            pTarget->push_back(instr);
-            pTargetAddress->MoveToNext();
+            placement->index = fixup.index + numExtra;
+            numExtra += placement->numWords - 1;
+            ++placement;
         }
-        else /* if (std::holds_alternative<LAFormatData>(fragment.data) */
-        {
-            auto const& data = std::get<LAFormatData>(fragment.data);
 
-            auto it = labelTable.find(data.target);
-            if (it == labelTable.end())
-            {
-                errors.push_back(GenerationError {
-                    GenerationError::Type::UndefinedLabelName,
-                    fragment.range,
-                });
+        changed = false;
+        for (auto& placement : placements)
+        {
+            if (!placement.isResizable)
                 continue;
-            }
 
-            uint32_t targetAddress = it->second;
-            if (targetAddress >= (1 << 16))
-            {
-                // II: | op: 6 | 5 | dest: 5 | imm: 16 |
-                uint32_t instr = 0;
-                instr |= (static_cast<uint32_t>(IIFormatOperation::LUI) << 26);
-                instr |= (static_cast<uint32_t>(data.destination & 0b11111) << 16);
-                instr |= ((targetAddress >> 16) << 0);
-
-                pTarget->push_back(instr);
-                pTargetAddress->MoveToNext();
-            }
-            targetAddress &= 0x00FF;
+            auto    fixup  = placement.fixup;
+            auto    target = *FindLabel(labelTable, fixup->target);
+            Address address { BaseOf(fixup->segment), placement.index * 4 };
 
-            if (targetAddress)
+            auto numWords = NumWordsOf(fixup->type, address, target, options.hasDelaySlots);
+            if (placement.numWords < numWords)
             {
-                // I: | op: 6 | src: 5 | dest: 5 | imm: 16 |
-                uint32_t instr = 0;
-                instr |= (static_cast<uint32_t>(IFormatOperation::ORI) << 26);
-                instr |= (static_cast<uint32_t>(data.destination & 0b11111u) << 21);
-                instr |= (static_cast<uint32_t>(data.destination & 0b11111u) << 16);
-                instr |= (targetAddress << 0);
-
-                pTarget->push_back(instr);
-                pTargetAddress->MoveToNext();
+                placement.numWords = numWords;
+                changed            = true;
             }
         }
     }
+    return numExtraWords;
+}
 
-    if (!errors.empty())
-        return CannotGenerate { std::move(errors) };
-    else
-        return CanGenerate { std::move(data), std::move(text) };
+/// <summary>
+/// Writes the placements of the given segment of the given laid out code.
+/// </summary>
+void WritePlacements(EncodedCode&                       code,
+                     Segment                            segment,
+                     std::pmr::vector<Placement> const& placements,
+                     LabelTable const&                  labelTable,
+                     uint32_t                           numExtraWords,
+                     GenerationOptions const&           options)
+{
+    auto& words = segment == Segment::Data ? code.data : code.text;
+    if (numExtraWords == 0)
+    {
+        for (auto const& placement : placements)
+        {
+            if (placement.fixup->segment != segment)
+                continue;
+
+            auto& word   = words[placement.index];
+            auto  target = *FindLabel(labelTable, placement.fixup->target);
+            Write(placement, word, target, options.hasDelaySlots, &word);
+        }
+        return;
+    }
+
+    std::pmr::vector<uint32_t> laidOut(words.size() + numExtraWords, words.get_allocator());
+
+    auto     output = laidOut.begin();
+    uint32_t next   = 0;
+    for (auto const& placement : placements)
+    {
+        if (placement.fixup->segment != segment)
+            continue;
+
+        auto index   = placement.fixup->index;
+        auto address = *FindLabel(labelTable, placement.fixup->target);
+        output       = std::copy(words.begin() + next, words.begin() + index, output);
+        output       = Write(placement, words[index], address, options.hasDelaySlots, output);
+        next         = index + 1;
+    }
+    std::copy(words.begin() + next, words.end(), output);
+    words = std::move(laidOut);
+}
+
+/// <summary>
+/// Generates machine code from the given array of fragments, which is a <c>std::vector</c> or a
+/// <c>std::pmr::vector</c>.
+/// </summary>
+template <typename Fragments>
+GenerationResult GenerateCodeFrom(Fragments const&           fragments,
+                                  GenerationOptions const&   options,
+                                  std::pmr::memory_resource* resource)
+{
+    // most fragments are instructions in the text segment
+    CodeGenerator generator { resource };
+    generator.Reserve(fragments.size());
+    for (auto const& fragment : fragments) generator.Add(fragment);
+    if (generator.Finish())
+        return generator.TakeCode();
+
+    // the errors are reported in another pass, which is needed only for erroneous code
+    EncodedCode     code { resource };
+    FragmentEncoder encoder { code };
+    for (auto const& fragment : fragments) encoder.Add(fragment);
+
+    return GenerateCode(std::move(code), options);
 }
 
+#undef ADD_FRAGMENT
+#undef FRAGMENT_CASES
+
 }
 
-GenerationResult GenerateCode(std::vector<Fragment> const& fragments)
+GenerationResult GenerateCode(std::pmr::vector<Fragment> const& fragments,
+                              GenerationOptions const&          options,
+                              std::pmr::memory_resource*        resource)
 {
-    ScanResult scanResult = ScanFragments(fragments);
-    if (!scanResult.errors.empty())
-        return CannotGenerate { std::move(scanResult.errors) };
+    return GenerateCodeFrom(fragments, options, resource);
+}
+
+GenerationResult GenerateCode(std::vector<Fragment> const& fragments,
+                              GenerationOptions const&     options,
+                              std::pmr::memory_resource*   resource)
+{
+    return GenerateCodeFrom(fragments, options, resource);
+}
+
+GenerationResult GenerateCodeParallel(std::pmr::vector<Fragment> const& fragments,
+                                      GenerationOptions const&          options,
+                                      ParallelOptions const&            parallelOptions)
+{
+    size_t numThreads = GetNumThreads(parallelOptions);
+    size_t chunkSize  = parallelOptions.chunkSize;
+    if (chunkSize == 0)
+        chunkSize = std::max(fragments.size() / (numThreads * 4), MinChunkSize);
+    if (numThreads <= 1 || fragments.size() <= chunkSize)
+        return GenerateCode(fragments, options);
+
+    std::vector<size_t> boundaries;
+    for (size_t i = 0; i < fragments.size(); i += chunkSize) boundaries.push_back(i);
+    boundaries.push_back(fragments.size());
 
-    return GenerateCodeInternal(fragments, scanResult);
+    size_t                   numChunks = boundaries.size() - 1;
+    std::vector<ChunkLayout> layouts(numChunks);
+    ParallelFor(numChunks, numThreads, [&](size_t i) {
+        auto begin = fragments.data();
+        FindLayoutEvents(begin + boundaries[i], begin + boundaries[i + 1], layouts[i]);
+    });
+
+    // Only the directives, the labels and the las change the layout, so the serial part visits a
+    // small portion of the fragments.
+    LabelTable labelTable;
+    uint32_t   numWords[2] = {};
+    if (!LayOutChunks(fragments, boundaries, layouts, labelTable, numWords))
+        return GenerateCode(fragments, options);
+
+    // Code which needs relaxation or has errors is generated by the serial version, so this is
+    // checked before any chunk is encoded.
+    std::atomic<bool> fits { true };
+    ParallelFor(numChunks, numThreads, [&](size_t i) {
+        if (!CheckReferences(layouts[i], labelTable))
+            fits.store(false, std::memory_order_relaxed);
+    });
+    if (!fits.load(std::memory_order_relaxed))
+        return GenerateCode(fragments, options);
+
+    CanGenerate code;
+    code.text.resize(numWords[static_cast<size_t>(Segment::Text)]);
+    code.data.resize(numWords[static_cast<size_t>(Segment::Data)]);
+    uint32_t* words[2] = { code.text.data(), code.data.data() };
+
+    ParallelFor(numChunks, numThreads, [&](size_t i) {
+        ChunkEncoder encoder { layouts[i], words, labelTable };
+        for (size_t j = boundaries[i]; j < boundaries[i + 1]; ++j) encoder.Add(fragments[j]);
+    });
+
+    return code;
+}
+
+EncodingResult EncodeCode(std::string_view           code,
+                          TokenizationOptions const& tokenizationOptions,
+                          ParseOptions const&        options,
+                          std::pmr::memory_resource* resource)
+{
+    EncodingResult  result { resource };
+    FragmentEncoder encoder { result.code };
+
+    // the fragments are encoded and dropped line by line
+    auto onLine = [&](ParseResult& parseResult) {
+        for (auto const& fragment : parseResult.fragments) encoder.Add(fragment);
+        parseResult.fragments.clear();
+    };
+    auto codeParseResult = ParseCode(code, tokenizationOptions, options, onLine, resource);
+
+    result.tokenizationErrors = std::move(codeParseResult.tokenizationErrors);
+    result.parsingErrors      = std::move(codeParseResult.parseResult.errors);
+    result.symbols            = std::move(codeParseResult.parseResult.symbols);
+    return result;
+}
+
+GenerationResult GenerateCode(EncodedCode code, GenerationOptions const& options)
+{
+    auto resource = code.text.get_allocator().resource();
+
+    std::pmr::vector<GenerationError> errors { resource };
+    LabelTable                        labelTable { resource };
+
+    for (auto const& fixup : code.fixups)
+    {
+        if (fixup.type != Fixup::Type::Label)
+            continue;
+
+        if (labelTable.size() <= fixup.target)
+            labelTable.resize(fixup.target + 1);
+        if (labelTable[fixup.target])
+        {
+            errors.push_back(GenerationError {
+                GenerationError::Type::LabelAlreadyDefined,
+                fixup.range,
+            });
+            continue;
+        }
+
+        labelTable[fixup.target] = Address { BaseOf(fixup.segment), fixup.index * 4 };
+    }
+
+    if (!errors.empty())
+        return CannotGenerate { std::move(errors) };
+
+    // Most code needs no relaxation, so the fixups are first completed in place with the labels
+    // laid out as encoded. The code is laid out again only if one of them does not fit in a word,
+    // or if a label is not defined, so that the other fixups are still checked.
+    bool needsLayout = false;
+    for (auto const& fixup : code.fixups)
+    {
+        if (fixup.type == Fixup::Type::Label)
+            continue;
+
+        auto target = FindLabel(labelTable, fixup.target);
+        if (target == nullptr)
+        {
+            needsLayout = true;
+            continue;
+        }
+
+        auto&   word = (fixup.segment == Segment::Data ? code.data : code.text)[fixup.index];
+        Address address { BaseOf(fixup.segment), fixup.index * 4 };
+        if (fixup.type == Fixup::Type::Branch)
+        {
+            auto offset = GetBranchOffset(address, *target);
+            needsLayout |= !offset;
+            word |= offset.value_or(0) & FormatTraits<Format::BI>::fixupMask;
+        }
+        else if (fixup.type == Fixup::Type::Jump)
+        {
+            auto jumpTarget = GetJumpTarget(*target);
+            needsLayout |= !jumpTarget;
+            word |= jumpTarget.value_or(0) & FormatTraits<Format::J>::fixupMask;
+        }
+        else if (NumLoadAddressWords(*target) == 1)
+        {
+            Write(Placement { &fixup, fixup.index, 1, true }, word, *target, false, &word);
+        }
+        else
+        {
+            needsLayout = true;
+        }
+    }
+
+    if (!needsLayout)
+        return CanGenerate { std::move(code.data), std::move(code.text) };
+
+    // Only the branches and the jumps of the text segment are relaxed. A fixup whose label is not
+    // defined keeps its word, and is not resized.
+    std::pmr::vector<Placement> placements { resource };
+    for (auto const& fixup : code.fixups)
+    {
+        if (fixup.type == Fixup::Type::Label)
+            continue;
+
+        bool isResizable = fixup.type == Fixup::Type::LoadAddress
+                           || (options.relaxBranches && fixup.segment == Segment::Text);
+        isResizable &= FindLabel(labelTable, fixup.target) != nullptr;
+        placements.push_back({ &fixup, fixup.index, 1, isResizable });
+    }
+
+    auto numExtraWords = LayOut(code, placements, labelTable, options);
+
+    // An erroneous branch or jump is not emitted by GenerateCode for fragments, which moves the
+    // following words of the segment by one word. The addresses of branches are adjusted in the
+    // same way so that the same errors are reported.
+    uint32_t numSkippedWords[2] = {};
+    for (auto const& placement : placements)
+    {
+        auto  fixup      = placement.fixup;
+        auto& numSkipped = numSkippedWords[static_cast<size_t>(fixup->segment)];
+
+        auto target = FindLabel(labelTable, fixup->target);
+        if (target == nullptr)
+        {
+            errors.push_back(GenerationError {
+                GenerationError::Type::UndefinedLabelName,
+                fixup->range,
+            });
+            ++numSkipped;
+            continue;
+        }
+        if (placement.isResizable)
+            continue;
+
+        Address address { BaseOf(fixup->segment), (placement.index - numSkipped) * 4 };
+        if (NumWordsOf(fixup->type, address, *target, options.hasDelaySlots) == 1)
+            continue;
+
+        errors.push_back(GenerationError {
+            fixup->type == Fixup::Type::Branch ? GenerationError::Type::BranchTargetTooFar
+                                               : GenerationError::Type::JumpAddressTooBig,
+            fixup->range,
+        });
+        ++numSkipped;
+    }
+
+    if (!errors.empty())
+        return CannotGenerate { std::move(errors) };
+
+    for (auto segment : { Segment::Text, Segment::Data })
+    {
+        auto numExtra = numExtraWords[static_cast<size_t>(segment)];
+        WritePlacements(code, segment, placements, labelTable, numExtra, options);
+    }
+    return CanGenerate { std::move(code.data), std::move(code.text) };
 }
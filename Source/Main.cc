@@ -1,13 +1,19 @@
 // Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
 // Licensed under the MIT License.
 
+#include <simple-mips-asm/Analysis.hh>
+#include <simple-mips-asm/Arena.hh>
 #include <simple-mips-asm/File.hh>
 #include <simple-mips-asm/Generation.hh>
+#include <simple-mips-asm/Optimization.hh>
 #include <simple-mips-asm/Parsing.hh>
+#include <simple-mips-asm/Scheduling.hh>
 #include <simple-mips-asm/Tokenization.hh>
 
 #include <filesystem>
 #include <iostream>
+#include <optional>
+#include <string_view>
 
 namespace fs = std::filesystem;
 using namespace std::literals::string_literals;
@@ -15,6 +21,37 @@ using namespace std::literals::string_literals;
 namespace
 {
 
+/// <summary>
+/// Represents options of the driver, which are given before the paths of the input files.
+/// </summary>
+struct DriverOptions
+{
+    /// <summary>
+    /// Removes the instructions which do nothing before generating code. Given by
+    /// <c>--optimize</c>.
+    /// </summary>
+    bool optimize = false;
+
+    /// <summary>
+    /// Assembles for a target with delay slots. The instructions before branches and jumps are
+    /// moved into their delay slots in place of nops, and relaxed branches keep their delay slots.
+    /// Given by <c>--delay-slots</c>.
+    /// </summary>
+    bool hasDelaySlots = false;
+
+    /// <summary>
+    /// Reorders the instructions of each basic block to separate loads from the instructions using
+    /// their results. Given by <c>--schedule-loads</c>.
+    /// </summary>
+    bool scheduleLoads = false;
+
+    /// <summary>
+    /// Prints the estimated cycles of each basic block and of the code after each label, with the
+    /// hot spots first. Given by <c>--cycle-report</c>.
+    /// </summary>
+    bool reportCycles = false;
+};
+
 #define CASE(ErrorTypename, ErrorType)                                                             \
     case ErrorTypename::Type::ErrorType: std::cerr << #ErrorType; break
 
@@ -39,7 +76,8 @@ void ReportFileReadError(char const* inputPath, FileReadError error)
     std::cerr << std::endl;
 }
 
-void ReportTokenizationErrors(char const* inputPath, std::vector<TokenizationError> const& errors)
+void ReportTokenizationErrors(char const*                                inputPath,
+                              std::pmr::vector<TokenizationError> const& errors)
 {
     for (auto const& error : errors)
     {
@@ -53,7 +91,7 @@ void ReportTokenizationErrors(char const* inputPath, std::vector<TokenizationErr
     }
 }
 
-void ReportParsingErrors(char const* inputPath, std::vector<ParsingError> const& errors)
+void ReportParsingErrors(char const* inputPath, std::pmr::vector<ParsingError> const& errors)
 {
     for (auto const& error : errors)
     {
@@ -68,7 +106,7 @@ void ReportParsingErrors(char const* inputPath, std::vector<ParsingError> const&
     }
 }
 
-void ReportGenerationErrors(char const* inputPath, std::vector<GenerationError> const& errors)
+void ReportGenerationErrors(char const* inputPath, std::pmr::vector<GenerationError> const& errors)
 {
     for (auto const& error : errors)
     {
@@ -76,7 +114,6 @@ void ReportGenerationErrors(char const* inputPath, std::vector<GenerationError>
         switch (error.type)
         {
             CASE(GenerationError, UndefinedLabelName);
-            CASE(GenerationError, OperandIsLabelInTextSegment);
             CASE(GenerationError, LabelAlreadyDefined);
             CASE(GenerationError, BranchTargetTooFar);
             CASE(GenerationError, JumpAddressTooBig);
@@ -85,6 +122,49 @@ void ReportGenerationErrors(char const* inputPath, std::vector<GenerationError>
     }
 }
 
+void ReportOptimization(char const* inputPath, OptimizationReport const& report)
+{
+    std::cerr << inputPath << ": removed " << report.removedInstructions.size()
+              << " instructions (WriteToZero: "
+              << report.Count(RemovedInstruction::Type::WriteToZero) << ", SelfAssignment: "
+              << report.Count(RemovedInstruction::Type::SelfAssignment) << ", BranchToNext: "
+              << report.Count(RemovedInstruction::Type::BranchToNext) << ')' << std::endl;
+}
+
+void ReportDelaySlots(char const* inputPath, DelaySlotReport const& report)
+{
+    std::cerr << inputPath << ": filled " << report.numFilledSlots << " delay slots, kept "
+              << report.numNopSlots << " nops" << std::endl;
+}
+
+void ReportLoadUseStalls(char const* inputPath, LoadUseReport const& report)
+{
+    std::cerr << inputPath << ": load-use stalls " << report.numStallsBefore << " -> "
+              << report.numStallsAfter << std::endl;
+}
+
+void ReportCycles(char const* inputPath, CycleReport const& report, SymbolTable const& symbols)
+{
+    std::cerr << inputPath << ": estimated " << report.totalCycles << " cycles in "
+              << report.blocks.size() << " blocks" << std::endl;
+    for (auto const& block : report.blocks)
+    {
+        std::cerr << inputPath << block.range << ": block";
+        if (block.label)
+            std::cerr << ' ' << symbols.GetName(*block.label);
+        std::cerr << ": " << block.cycles << " cycles, weighted " << block.weightedCycles << " ("
+                  << block.numInstructions << " instructions, " << block.numStallCycles
+                  << " stall cycles, " << block.numPenaltyCycles << " branch cycles, loop depth "
+                  << block.loopDepth << ')' << std::endl;
+    }
+    for (auto const& label : report.labels)
+    {
+        std::cerr << inputPath << label.range << ": label " << symbols.GetName(label.symbol)
+                  << ": " << label.cycles << " cycles, weighted " << label.weightedCycles
+                  << std::endl;
+    }
+}
+
 void ReportFileWriteError(fs::path const& outputPath, FileWriteError error)
 {
     std::cerr << outputPath << ": FileWriteError: ";
@@ -101,34 +181,98 @@ void ReportBadAlloc(char const* inputPath)
     std::cerr << inputPath << ": BadAlloc" << std::endl;
 }
 
-void HandleFile(char const* inputPath) noexcept
+/// <summary>
+/// Parses the given code, and generates code from the fragments after the passes the given
+/// options enable.
+/// </summary>
+std::optional<GenerationResult>
+    GenerateOptimizedCode(char const*                inputPath,
+                          std::string_view           file,
+                          DriverOptions const&       options,
+                          TokenizationOptions const& tokenizationOptions,
+                          std::pmr::memory_resource* resource)
+{
+    auto codeParseResult = ParseCode(file, tokenizationOptions, {}, resource);
+    if (auto const& errors = codeParseResult.tokenizationErrors; !errors.empty())
+    {
+        ReportTokenizationErrors(inputPath, errors);
+        return std::nullopt;
+    }
+    if (auto const& errors = codeParseResult.parseResult.errors; !errors.empty())
+    {
+        ReportParsingErrors(inputPath, errors);
+        return std::nullopt;
+    }
+
+    auto& fragments = codeParseResult.parseResult.fragments;
+    if (options.optimize)
+    {
+        OptimizationOptions optimizationOptions;
+        optimizationOptions.hasDelaySlots = options.hasDelaySlots;
+        ReportOptimization(inputPath, Optimize(fragments, optimizationOptions));
+    }
+    if (options.hasDelaySlots)
+        ReportDelaySlots(inputPath, FillDelaySlots(fragments));
+    if (options.scheduleLoads)
+    {
+        SchedulingOptions schedulingOptions;
+        schedulingOptions.hasDelaySlots = options.hasDelaySlots;
+        ReportLoadUseStalls(inputPath, ScheduleLoads(fragments, schedulingOptions));
+    }
+    if (options.reportCycles)
+    {
+        PipelineModel model;
+        model.hasDelaySlots = options.hasDelaySlots;
+        auto const& symbols = codeParseResult.parseResult.symbols;
+        ReportCycles(inputPath, EstimateCycles(fragments, model), symbols);
+    }
+
+    GenerationOptions generationOptions;
+    generationOptions.hasDelaySlots = options.hasDelaySlots;
+    return GenerateCode(fragments, generationOptions, resource);
+}
+
+void HandleFile(char const*                inputPath,
+                DriverOptions const&       options,
+                std::pmr::memory_resource* resource) noexcept
 {
     try
     {
         // read the given file
-        auto fileReadResult = ReadFile(inputPath);
+        auto fileReadResult = ReadFile(inputPath, resource);
         if (std::holds_alternative<CannotRead>(fileReadResult))
             return ReportFileReadError(inputPath, std::get<CannotRead>(fileReadResult).error);
         auto const& file = std::get<CanRead>(fileReadResult).content;
 
-        // tokenize source
-        auto tokenizationResult = Tokenize(file);
-        if (auto const& errors = tokenizationResult.errors; !errors.empty())
-            return ReportTokenizationErrors(inputPath, errors);
-        auto const& tokens = tokenizationResult.tokens;
-
-        // parse tokens
-        auto parseResult = Parse(tokens);
-        if (auto const& errors = parseResult.errors; !errors.empty())
-            return ReportParsingErrors(inputPath, errors);
-        auto const& fragments = parseResult.fragments;
-
-        // generate machine code
-        auto generationResult = GenerateCode(fragments);
-        if (std::holds_alternative<CannotGenerate>(generationResult))
+        // tokenize and parse source, and generate machine code
+        TokenizationOptions tokenizationOptions;
+        tokenizationOptions.elideWhitespaces = true;
+        tokenizationOptions.skipComments     = true;
+
+        std::optional<GenerationResult> generationResult;
+        if (options.optimize || options.hasDelaySlots || options.scheduleLoads
+            || options.reportCycles)
+        {
+            generationResult
+                = GenerateOptimizedCode(inputPath, file, options, tokenizationOptions, resource);
+            if (!generationResult)
+                return;
+        }
+        else
+        {
+            auto encodingResult = EncodeCode(file, tokenizationOptions, {}, resource);
+            if (auto const& errors = encodingResult.tokenizationErrors; !errors.empty())
+                return ReportTokenizationErrors(inputPath, errors);
+            if (auto const& errors = encodingResult.parsingErrors; !errors.empty())
+                return ReportParsingErrors(inputPath, errors);
+
+            generationResult = GenerateCode(std::move(encodingResult.code));
+        }
+
+        if (std::holds_alternative<CannotGenerate>(*generationResult))
             return ReportGenerationErrors(inputPath,
-                                          std::get<CannotGenerate>(generationResult).errors);
-        auto const& code = std::get<CanGenerate>(generationResult);
+                                          std::get<CannotGenerate>(*generationResult).errors);
+        auto const& code = std::get<CanGenerate>(*generationResult);
 
         // write code to file
         fs::path outputPath = inputPath;
@@ -150,5 +294,29 @@ void HandleFile(char const* inputPath) noexcept
 int main(int argc, char* argv[])
 {
     std::ios::sync_with_stdio(false);
-    for (int i = 1; i < argc; ++i) HandleFile(argv[i]);
+
+    DriverOptions options;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] == '-'; ++i)
+    {
+        if (std::string_view(argv[i]) == "--optimize")
+            options.optimize = true;
+        else if (std::string_view(argv[i]) == "--delay-slots")
+            options.hasDelaySlots = true;
+        else if (std::string_view(argv[i]) == "--schedule-loads")
+            options.scheduleLoads = true;
+        else if (std::string_view(argv[i]) == "--cycle-report")
+            options.reportCycles = true;
+        else
+            std::cerr << argv[i] << ": UnknownOption" << std::endl;
+    }
+
+    // every file is read and assembled in the arena, which is reused for the next file
+    Arena arena;
+    for (; i < argc; ++i)
+    {
+        HandleFile(argv[i], options, &arena);
+        arena.Reset();
+    }
 }
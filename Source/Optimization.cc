@@ -0,0 +1,202 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <simple-mips-asm/Optimization.hh>
+
+#include "RegisterUse.hh"
+#include <algorithm>
+#include <optional>
+#include <variant>
+
+namespace
+{
+
+using RemovalType = RemovedInstruction::Type;
+
+// ------------------------------------------  No-ops ------------------------------------------ //
+
+std::optional<RemovalType> FindNoOp(RFormatData const& data) noexcept
+{
+    if (data.destination == 0)
+        return RemovalType::WriteToZero;
+
+    bool isSource1 = data.destination == data.source1;
+    bool isSource2 = data.destination == data.source2;
+    bool isSelf    = false;
+    switch (data.function)
+    {
+    case RFormatFunction::ADDU:
+        isSelf = (isSource1 && data.source2 == 0) || (isSource2 && data.source1 == 0);
+        break;
+    case RFormatFunction::OR:
+        isSelf = (isSource1 && data.source2 == 0) || (isSource2 && data.source1 == 0)
+                 || (isSource1 && isSource2);
+        break;
+    case RFormatFunction::SUBU: isSelf = isSource1 && data.source2 == 0; break;
+    case RFormatFunction::AND: isSelf = isSource1 && isSource2; break;
+    default: break;
+    }
+
+    if (isSelf)
+        return RemovalType::SelfAssignment;
+    return std::nullopt;
+}
+
+std::optional<RemovalType> FindNoOp(SRFormatData const& data) noexcept
+{
+    if (data.destination == 0)
+        return RemovalType::WriteToZero;
+    if (data.destination == data.source && data.shiftAmount == 0)
+        return RemovalType::SelfAssignment;
+    return std::nullopt;
+}
+
+std::optional<RemovalType> FindNoOp(IFormatData const& data) noexcept
+{
+    if (data.destination == 0)
+        return RemovalType::WriteToZero;
+
+    bool isIdentity = data.operation == IFormatOperation::ADDIU
+                      || data.operation == IFormatOperation::ORI;
+    if (isIdentity && data.destination == data.source && data.immediate == 0)
+        return RemovalType::SelfAssignment;
+    return std::nullopt;
+}
+
+std::optional<RemovalType> FindNoOp(IIFormatData const& data) noexcept
+{
+    if (data.destination == 0)
+        return RemovalType::WriteToZero;
+    return std::nullopt;
+}
+
+std::optional<RemovalType> FindNoOp(LAFormatData const& data) noexcept
+{
+    if (data.destination == 0)
+        return RemovalType::WriteToZero;
+    return std::nullopt;
+}
+
+// directives, labels, memory accesses, and control transfers
+template <typename Data>
+std::optional<RemovalType> FindNoOp(Data const&) noexcept
+{
+    return std::nullopt;
+}
+
+/// <summary>
+/// Returns the label of the given fragment if it is a branch or a jump which does nothing else.
+/// </summary>
+std::optional<SymbolId> FindPlainTransfer(FragmentData const& data) noexcept
+{
+    if (auto branch = std::get_if<BIFormatData>(&data))
+        return branch->target;
+    auto jump = std::get_if<JFormatData>(&data);
+    if (jump && jump->operation == JFormatOperation::J)
+        return jump->target;
+    return std::nullopt;
+}
+
+}
+
+size_t OptimizationReport::Count(RemovedInstruction::Type type) const noexcept
+{
+    auto isOfType = [type](RemovedInstruction const& removed) { return removed.type == type; };
+    return std::count_if(removedInstructions.begin(), removedInstructions.end(), isOfType);
+}
+
+OptimizationReport Optimize(std::pmr::vector<Fragment>& fragments,
+                            OptimizationOptions const&  options)
+{
+    auto resource = fragments.get_allocator().resource();
+
+    // the instructions in the data segment are data words, which are never removed
+    std::pmr::vector<std::optional<RemovalType>> removals { resource };
+    std::pmr::vector<bool>                       isInTextSegment(resource);
+    removals.reserve(fragments.size());
+    isInTextSegment.reserve(fragments.size());
+
+    // the labels defined in either segment, which may be after the instructions referring to them
+    std::pmr::vector<bool> isDefined(resource);
+
+    bool isText = true;
+    for (auto const& fragment : fragments)
+    {
+        auto const& data = fragment.data;
+        if (std::holds_alternative<DataDirData>(data) || std::holds_alternative<TextDirData>(data))
+            isText = std::holds_alternative<TextDirData>(data);
+        if (auto label = std::get_if<LabelData>(&data))
+        {
+            if (isDefined.size() <= label->symbol)
+                isDefined.resize(label->symbol + 1, false);
+            isDefined[label->symbol] = true;
+        }
+
+        auto findNoOp = [](auto const& data) { return FindNoOp(data); };
+        removals.push_back(isText ? std::visit(findNoOp, data) : std::nullopt);
+        isInTextSegment.push_back(isText);
+    }
+
+    // an la of an undefined label is kept, so that the code generator still reports the label
+    for (size_t i = 0; i < fragments.size(); ++i)
+    {
+        auto la = std::get_if<LAFormatData>(&fragments[i].data);
+        if (la && (la->target >= isDefined.size() || !isDefined[la->target]))
+            removals[i] = std::nullopt;
+    }
+
+    if (options.hasDelaySlots)
+    {
+        // the labels between a branch and its delay slot refer to the delay slot
+        bool isInDelaySlot = false;
+        for (size_t i = 0; i < fragments.size(); ++i)
+        {
+            auto const& data = fragments[i].data;
+            if (std::holds_alternative<LabelData>(data))
+                continue;
+            if (isInDelaySlot)
+                removals[i] = std::nullopt;
+            isInDelaySlot = isInTextSegment[i] && IsControlTransfer(data);
+        }
+    }
+
+    // The fragments are visited backward, so a branch is removed after the instructions between
+    // it and its label. The labels between the current fragment and the next kept instruction
+    // are collected.
+    std::pmr::vector<SymbolId> nextLabels { resource };
+    for (size_t i = fragments.size(); i-- != 0;)
+    {
+        if (removals[i])
+            continue;
+
+        auto const& data = fragments[i].data;
+        if (auto label = std::get_if<LabelData>(&data); label && isInTextSegment[i])
+        {
+            nextLabels.push_back(label->symbol);
+            continue;
+        }
+
+        bool canRemove = isInTextSegment[i] && !options.hasDelaySlots;
+        auto target    = canRemove ? FindPlainTransfer(data) : std::nullopt;
+        if (target && std::find(nextLabels.begin(), nextLabels.end(), *target) != nextLabels.end())
+        {
+            removals[i] = RemovalType::BranchToNext;
+            continue;
+        }
+
+        nextLabels.clear();
+    }
+
+    OptimizationReport report { resource };
+    size_t             numKept = 0;
+    for (size_t i = 0; i < fragments.size(); ++i)
+    {
+        if (removals[i])
+            report.removedInstructions.push_back({ *removals[i], fragments[i].range });
+        else
+            fragments[numKept++] = std::move(fragments[i]);
+    }
+    fragments.erase(fragments.begin() + numKept, fragments.end());
+
+    return report;
+}
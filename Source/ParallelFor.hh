@@ -0,0 +1,85 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_PARALLEL_FOR_HH
+#define SIMPLE_MIPS_ASM_PARALLEL_FOR_HH
+
+#include <simple-mips-asm/Parallel.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Returns the number of threads the given options request.
+/// </summary>
+inline size_t GetNumThreads(ParallelOptions const& options) noexcept
+{
+    if (options.numThreads != 0)
+        return options.numThreads;
+
+    size_t numThreads = std::thread::hardware_concurrency();
+    return numThreads != 0 ? numThreads : 1;
+}
+
+/// <summary>
+/// Calls <c>function(i)</c> for every i in [0, count) using up to <c>numThreads</c> threads,
+/// including the calling thread. Indices are handed out one by one, so the work is balanced even
+/// if the costs of the indices differ. The first exception thrown by the function is rethrown
+/// after all threads finish.
+/// </summary>
+template <typename Function>
+void ParallelFor(size_t count, size_t numThreads, Function&& function)
+{
+    numThreads = std::min(numThreads, count);
+    if (numThreads <= 1)
+    {
+        for (size_t i = 0; i < count; ++i) function(i);
+        return;
+    }
+
+    std::atomic<size_t> next { 0 };
+    std::exception_ptr  exception;
+    std::mutex          exceptionMutex;
+
+    auto work = [&]() noexcept {
+        try
+        {
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+                function(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock { exceptionMutex };
+            if (!exception)
+                exception = std::current_exception();
+            next.store(count, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (size_t i = 1; i < numThreads; ++i)
+    {
+        try
+        {
+            threads.emplace_back(work);
+        }
+        catch (std::system_error const&)
+        {
+            // continue with the threads created so far
+            break;
+        }
+    }
+    work();
+    for (auto& thread : threads) thread.join();
+
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+#endif
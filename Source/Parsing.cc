@@ -4,28 +4,122 @@
 #include <simple-mips-asm/Formats.hh>
 #include <simple-mips-asm/Parsing.hh>
 
-#include <cctype>
+#include "FormatTraits.hh"
+#include "ParallelFor.hh"
+#include <array>
 #include <charconv>
-#include <limits>
+#include <cstring>
+#include <optional>
 #include <string_view>
-#include <unordered_map>
 
 using namespace std::literals::string_view_literals;
 
 namespace
 {
 
-// ----------------------------------------  Constants ----------------------------------------- //
+// ---------------------------------------  Iterators ------------------------------------------ //
 
-constexpr uint8_t NumRegisters = 32;
+/// <summary>
+/// Represents the fields of a token in a <c>TokenBuffer</c> which parsers read.
+/// </summary>
+struct TokenView
+{
+    Token::Type      type;
+    std::string_view value;
+};
 
-// -----------------------------------  Parser output types ------------------------------------ //
+/// <summary>
+/// Makes <c>it->type</c> and <c>it->value</c> available on iterators which do not point to an
+/// actual <c>Token</c>.
+/// </summary>
+struct TokenViewPointer
+{
+    TokenView view;
+
+    TokenView const* operator->() const noexcept
+    {
+        return &view;
+    }
+};
+
+/// <summary>
+/// A random access iterator over a <c>TokenBuffer</c>.
+/// </summary>
+class CompactIterator
+{
+  public:
+    CompactIterator(TokenBuffer const& buffer, size_t index) noexcept :
+        _buffer { &buffer }, _index { index }
+    {}
+
+  public:
+    TokenViewPointer operator->() const noexcept
+    {
+        auto const& b = *_buffer;
+        return { {
+            b.types[_index],
+            std::string_view(b.code.data() + b.offsets[_index], b.lengths[_index]),
+        } };
+    }
+
+    Range GetRange() const noexcept
+    {
+        return _buffer->GetRange(_index);
+    }
+
+    CompactIterator& operator++() noexcept
+    {
+        ++_index;
+        return *this;
+    }
+
+    CompactIterator operator+(ptrdiff_t offset) const noexcept
+    {
+        return CompactIterator { *_buffer, _index + offset };
+    }
+
+    CompactIterator operator-(ptrdiff_t offset) const noexcept
+    {
+        return CompactIterator { *_buffer, _index - offset };
+    }
+
+    bool operator==(CompactIterator const& rhs) const noexcept
+    {
+        return _index == rhs._index;
+    }
+
+    bool operator!=(CompactIterator const& rhs) const noexcept
+    {
+        return _index != rhs._index;
+    }
+
+    bool operator<=(CompactIterator const& rhs) const noexcept
+    {
+        return _index <= rhs._index;
+    }
+
+  private:
+    TokenBuffer const* _buffer;
+    size_t             _index;
+};
+
+template <typename Iterator>
+Range RangeOf(Iterator it) noexcept
+{
+    return it->range;
+}
+
+Range RangeOf(CompactIterator it) noexcept
+{
+    return it.GetRange();
+}
 
-using Iterator = std::vector<Token>::const_iterator;
+// -----------------------------------  Parser output types ------------------------------------ //
 
 /// <summary>
 /// Returned when the parser cannot parse the given token stream.
 /// </summary>
+template <typename Iterator>
 struct CannotParse
 {
     ParsingError::Type errorType;
@@ -35,6 +129,7 @@ struct CannotParse
 /// <summary>
 /// Returned when the parser can parse the given token stream.
 /// </summary>
+template <typename Iterator>
 struct CanParse
 {
     FragmentData data;
@@ -44,53 +139,18 @@ struct CanParse
 /// <summary>
 /// Union of possible parser output types
 /// </summary>
-using ParserOutput = std::variant<CannotParse, CanParse>;
-
-/// <summary>
-/// Pattern matcher
-/// </summary>
-using Parser = ParserOutput (*)(Iterator, Iterator);
+template <typename Iterator>
+using ParserOutput = std::variant<CannotParse<Iterator>, CanParse<Iterator>>;
 
 // ----------------------------------------  Utilities ----------------------------------------- //
 
-struct CaseInsensitiveHash
-{
-    constexpr size_t operator()(std::string_view const& lhs) const
-    {
-        size_t rtn = _fnvOffsetBasis;
-
-        for (char c : lhs)
-        {
-            rtn ^= size_t(toupper(c));
-            rtn *= _fnvPrime;
-        }
-
-        return rtn;
-    }
-
-  private:
-    constexpr static size_t _fnvOffsetBasis = 0xCBF29CE484222325;
-    constexpr static size_t _fnvPrime       = 0x00000100000001B3;
-};
-
-struct CaseInsensitiveEqual
-{
-    constexpr bool operator()(std::string_view const& lhs, std::string_view const& rhs) const
-    {
-        return lhs.size() == rhs.size()
-               && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char l, char r) {
-                      return toupper(l) == toupper(r);
-                  });
-    }
-};
-
 template <typename LeftT, typename... ValueTs>
 bool IsOneOf(LeftT left, ValueTs... valuesToCompare)
 {
     return ((left == valuesToCompare) || ...);
 }
 
-template <typename T>
+template <typename T, typename Iterator>
 bool GetInteger(Iterator current, T& output)
 {
     if (current->type == Token::Type::Integer)
@@ -115,82 +175,280 @@ bool GetInteger(Iterator current, T& output)
     return true;
 }
 
-// ---------------------------------  Instruction name tables ---------------------------------- //
+// ---------------------------------------  Name table ----------------------------------------- //
 
-template <typename T>
-using InstructionTable
-    = std::unordered_map<std::string_view, T, CaseInsensitiveHash, CaseInsensitiveEqual>;
+/// <summary>
+/// Represents what a word in a statement resolves to. Directives and instructions tell the
+/// grammar of the tokens following the leading word of a statement.
+/// </summary>
+enum class NameKind : uint8_t
+{
+    // directives
+    DataDirective,
+    TextDirective,
+    WordDirective,
 
-InstructionTable<RFormatFunction> const _rFormatTable {
-    { "ADDU"sv, RFormatFunction::ADDU }, { "SUBU"sv, RFormatFunction::SUBU },
-    { "AND"sv, RFormatFunction::AND },   { "OR"sv, RFormatFunction::OR },
-    { "NOR"sv, RFormatFunction::NOR },   { "SLTU"sv, RFormatFunction::SLTU },
-};
+    // instructions of the format of the entry
+    Instruction,
 
-InstructionTable<JRFormatFunction> const _jrFormatTable {
-    { "JR"sv, JRFormatFunction::JR },
+    // register aliases
+    Register,
 };
 
-InstructionTable<SRFormatFunction> const _srFormatTable {
-    { "SLL"sv, SRFormatFunction::SLL },
-    { "SRL"sv, SRFormatFunction::SRL },
-};
+constexpr bool IsDirective(NameKind kind) noexcept
+{
+    return kind <= NameKind::WordDirective;
+}
 
-InstructionTable<IFormatOperation> const _iFormatTable {
-    { "ADDIU"sv, IFormatOperation::ADDIU },
-    { "ANDI"sv, IFormatOperation::ANDI },
-    { "ORI"sv, IFormatOperation::ORI },
-    { "SLTIU"sv, IFormatOperation::SLTIU },
-};
+constexpr bool IsInstruction(NameKind kind) noexcept
+{
+    return kind == NameKind::Instruction;
+}
 
-InstructionTable<BIFormatOperation> const _biFormatTable {
-    { "BEQ"sv, BIFormatOperation::BEQ },
-    { "BNE"sv, BIFormatOperation::BNE },
-};
+/// <summary>
+/// The maximum length of names. A name fits in a 64-bit integer.
+/// </summary>
+constexpr size_t MaxNameLength = sizeof(uint64_t);
 
-InstructionTable<IIFormatOperation> const _iiFormatTable {
-    { "LUI"sv, IIFormatOperation::LUI },
-};
+/// <summary>
+/// Returns the mask of the lower bytes of a 64-bit integer holding a name of the given length.
+/// </summary>
+constexpr uint64_t NameMask(size_t length) noexcept
+{
+    return length == MaxNameLength ? ~uint64_t(0) : (uint64_t(1) << (length * 8)) - 1;
+}
 
-InstructionTable<OIFormatOperation> const _oiFormatTable {
-    { "LB"sv, OIFormatOperation::LB },
-    { "LW"sv, OIFormatOperation::LW },
-    { "SB"sv, OIFormatOperation::SB },
-    { "SW"sv, OIFormatOperation::SW },
+/// <summary>
+/// Packs the given name into a 64-bit integer in little endian and folds its case. Setting the
+/// 0x20 bit of every byte maps upper case letters to lower case ones and keeps digits as they
+/// are; an underscore becomes 0x7F, which does not appear in a word otherwise.
+/// </summary>
+constexpr uint64_t PackName(std::string_view name) noexcept
+{
+    uint64_t key = 0;
+    for (size_t i = 0; i < name.size(); ++i)
+        key |= uint64_t(static_cast<unsigned char>(name[i]) | 0x20) << (i * 8);
+    return key;
+}
+
+/// <summary>
+/// Same as <c>PackName</c> but reads the name with at most two unaligned loads and folds all of
+/// its bytes at once. The length of the given name must be in [1, <c>MaxNameLength</c>].
+/// </summary>
+inline uint64_t LoadName(char const* name, size_t length) noexcept
+{
+    uint64_t key;
+    if (length >= 4)
+    {
+        // the two loads overlap when the length is less than 8, where the bytes are the same
+        uint32_t low, high;
+        std::memcpy(&low, name, sizeof(low));
+        std::memcpy(&high, name + length - sizeof(high), sizeof(high));
+        key = low | (uint64_t(high) << ((length - sizeof(high)) * 8));
+    }
+    else
+    {
+        key = uint64_t(static_cast<unsigned char>(name[0]))
+              | uint64_t(static_cast<unsigned char>(name[length / 2])) << (length / 2 * 8)
+              | uint64_t(static_cast<unsigned char>(name[length - 1])) << ((length - 1) * 8);
+    }
+    return key | (0x2020202020202020 & NameMask(length));
+}
+
+/// <summary>
+/// Represents an entry of the name table.
+/// </summary>
+struct NameEntry
+{
+    uint64_t key;
+    NameKind kind;
+    Format   format;
+    uint8_t  code; // the function or operation of the format, or the register number
 };
 
-InstructionTable<JFormatOperation> const _jFormatTable {
-    { "J"sv, JFormatOperation::J },
-    { "JAL"sv, JFormatOperation::JAL },
+constexpr std::string_view _registerNames[NumRegisters] = {
+    "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3", "t0", "t1", "t2",
+    "t3",   "t4", "t5", "t6", "t7", "s0", "s1", "s2", "s3", "s4", "s5",
+    "s6",   "s7", "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra",
 };
 
-InstructionTable<LAFormatType> const _laFormatTable {
-    { "LA"sv, LAFormatType::LA },
+constexpr size_t NumDirectives = 3;
+
+constexpr size_t NumNames = 1 + NumDirectives + std::size(Instructions) + NumRegisters;
+
+/// <summary>
+/// Builds the name table from the directives, the instruction set, and the register aliases. The
+/// first entry never matches since no name packs to zero.
+/// </summary>
+constexpr std::array<NameEntry, NumNames> MakeNames() noexcept
+{
+    std::array<NameEntry, NumNames> names {};
+
+    size_t index   = 1;
+    names[index++] = { PackName("data"), NameKind::DataDirective, Format {}, 0 };
+    names[index++] = { PackName("text"), NameKind::TextDirective, Format {}, 0 };
+    names[index++] = { PackName("word"), NameKind::WordDirective, Format {}, 0 };
+    for (auto const& instruction : Instructions)
+    {
+        names[index++] = {
+            PackName(instruction.mnemonic),
+            NameKind::Instruction,
+            instruction.format,
+            instruction.code,
+        };
+    }
+    for (size_t i = 0; i < NumRegisters; ++i)
+    {
+        auto number    = static_cast<uint8_t>(i);
+        names[index++] = { PackName(_registerNames[i]), NameKind::Register, Format {}, number };
+    }
+
+    return names;
+}
+
+constexpr std::array<NameEntry, NumNames> _names = MakeNames();
+
+/// <summary>
+/// Checks whether every name fits in a 64-bit integer and no two names are the same.
+/// </summary>
+constexpr bool AreNamesValid() noexcept
+{
+    for (auto const& instruction : Instructions)
+    {
+        if (instruction.mnemonic.empty() || MaxNameLength < instruction.mnemonic.size())
+            return false;
+    }
+    for (size_t i = 1; i < NumNames; ++i)
+    {
+        for (size_t j = 1; j < i; ++j)
+        {
+            if (_names[i].key == _names[j].key)
+                return false;
+        }
+    }
+    return true;
+}
+
+static_assert(AreNamesValid(), "names must be distinct and at most 8 characters long");
+
+static_assert(NumNames < 256, "indices of names must fit in a byte");
+
+/// <summary>
+/// Represents a perfect hash function over the names, <c>(key * multiplier) >> (64 - 8)</c>,
+/// and the indices of the names in each of the 256 slots.
+/// </summary>
+struct NameHash
+{
+    uint64_t multiplier;
+    uint8_t  slots[256];
+
+    constexpr size_t GetSlot(uint64_t key) const noexcept
+    {
+        return static_cast<size_t>((key * multiplier) >> 56);
+    }
 };
 
+/// <summary>
+/// Searches for a multiplier which maps every name to a different slot.
+/// </summary>
+constexpr NameHash MakeNameHash() noexcept
+{
+    NameHash hash {};
+    uint64_t seed = 0x9E3779B97F4A7C15;
+    for (int trial = 0; trial < 100000; ++trial)
+    {
+        // SplitMix64
+        uint64_t candidate = (seed += 0x9E3779B97F4A7C15);
+        candidate          = (candidate ^ (candidate >> 30)) * 0xBF58476D1CE4E5B9;
+        candidate          = (candidate ^ (candidate >> 27)) * 0x94D049BB133111EB;
+        candidate          = (candidate ^ (candidate >> 31)) | 1;
+
+        hash.multiplier = candidate;
+
+        uint64_t used[4] {};
+        bool     perfect = true;
+        for (size_t i = 1; i < NumNames && perfect; ++i)
+        {
+            size_t slot = hash.GetSlot(_names[i].key);
+            perfect     = (used[slot / 64] & (uint64_t(1) << (slot % 64))) == 0;
+            used[slot / 64] |= uint64_t(1) << (slot % 64);
+        }
+        if (!perfect)
+            continue;
+
+        for (auto& slot : hash.slots) slot = 0;
+        for (size_t i = 1; i < NumNames; ++i)
+            hash.slots[hash.GetSlot(_names[i].key)] = static_cast<uint8_t>(i);
+        return hash;
+    }
+
+    hash.multiplier = 0;
+    return hash;
+}
+
+constexpr NameHash _nameHash = MakeNameHash();
+
+static_assert(_nameHash.multiplier != 0, "no perfect hash function was found");
+
+/// <summary>
+/// Returns the entry of the given name, or <c>nullptr</c> if there is no such entry. Names are
+/// case-insensitive.
+/// </summary>
+inline NameEntry const* FindName(std::string_view name) noexcept
+{
+    if (name.empty() || MaxNameLength < name.size())
+        return nullptr;
+
+    uint64_t         key   = LoadName(name.data(), name.size());
+    NameEntry const& entry = _names[_nameHash.slots[_nameHash.GetSlot(key)]];
+    return entry.key == key ? &entry : nullptr;
+}
+
+/// <summary>
+/// Reads the number of the register indicated by the given Integer or Word token.
+/// </summary>
+template <typename Iterator>
+bool GetRegister(Iterator current, uint8_t& output)
+{
+    if (current->type == Token::Type::Word)
+    {
+        auto name = FindName(current->value);
+        if (name == nullptr || name->kind != NameKind::Register)
+            return false;
+
+        output = name->code;
+        return true;
+    }
+
+    return GetInteger(current, output) && output < NumRegisters;
+}
+
 // -----------------------------------------  Parsers ------------------------------------------ //
 
-// Defines an iterator indicating the current position.
-#define DEFINE_CURRENT Iterator current = begin
+// Each parser below receives the iterator `current` pointing to the first token it has to read and
+// returns CannotParse for the first token which does not match the grammar.
 
 // Returns CannotParse with UnexpectedEof.
-#define UNEXPECTED_EOF return CannotParse { ParsingError::Type::UnexpectedEof, current };
+#define UNEXPECTED_EOF                                                                             \
+    return CannotParse<Iterator> { ParsingError::Type::UnexpectedEof, current };
 
 // Returns CannotParse with UnexpectedToken.
-#define UNEXPECTED_TOKEN return CannotParse { ParsingError::Type::UnexpectedToken, current };
+#define UNEXPECTED_TOKEN                                                                           \
+    return CannotParse<Iterator> { ParsingError::Type::UnexpectedToken, current };
 
 // Returns CannotParse with UnexpectedValue.
-#define UNEXPECTED_VALUE return CannotParse { ParsingError::Type::UnexpectedValue, current };
+#define UNEXPECTED_VALUE                                                                           \
+    return CannotParse<Iterator> { ParsingError::Type::UnexpectedValue, current };
 
 // Returns CanParse with the given data.
-#define RESULT(data) return CanParse { data, current == end ? current : current + 1 };
+#define RESULT(data) return CanParse<Iterator> { data, current == end ? current : current + 1 };
 
-// Advances the iterator defined by DEFINE_CURRENT.
+// Advances the iterator.
 #define ADVANCE_FOR_NEXT                                                                           \
     {                                                                                              \
         ++current;                                                                                 \
         if (current == end)                                                                        \
-            return CannotParse { ParsingError::Type::UnexpectedEof, current };                     \
+            return CannotParse<Iterator> { ParsingError::Type::UnexpectedEof, current };           \
     }
 
 // Advances the iterator until non-whitespace token appears.
@@ -204,30 +462,13 @@ InstructionTable<LAFormatType> const _laFormatTable {
     if (!IsOneOf(current->type, __VA_ARGS__))                                                      \
     UNEXPECTED_TOKEN
 
-// Advances the iterator until non-whitespace token appears. If that first non-whitespace token is
-// not a Word with the given value, returns CannotParse with UnexpectedValue.
-#define EXPECT_WORD(ExpectedValue)                                                                 \
-    EXPECT_NEXT(Token::Type::Word);                                                                \
-    if (!CaseInsensitiveEqual {}(current->value, ExpectedValue))                                   \
-    UNEXPECTED_VALUE
-
-// Advances the iterator until non-whitespace token appears. If that first non-whitespace token is
-// not a Word where the value is registered in the given table, returns CannotParse with
-// UnexpectedValue. This macro must be used only once within one function.
-#define EXPECT_OPCODE(Table)                                                                       \
-    EXPECT_NEXT(Token::Type::Word);                                                                \
-    auto it = Table.find(current->value);                                                          \
-    if (it == Table.end())                                                                         \
-        UNEXPECTED_VALUE;                                                                          \
-    auto type = it->second;
-
 // Checks whether the next incoming tokens indicate a register.
 #define EXPECT_REGISTER(OutputVariableName)                                                        \
     EXPECT_NEXT(Token::Type::Dollar);                                                              \
     ADVANCE_FOR_NEXT;                                                                              \
-    EXPECT_NEXT(Token::Type::Integer);                                                             \
+    EXPECT_NEXT(Token::Type::Integer, Token::Type::Word);                                          \
     uint8_t OutputVariableName;                                                                    \
-    if (!GetInteger(current, OutputVariableName) || NumRegisters <= OutputVariableName)            \
+    if (!GetRegister(current, OutputVariableName))                                                 \
         UNEXPECTED_VALUE;
 
 // Checks whether the next incoming token indicates an immediate number.
@@ -244,39 +485,10 @@ InstructionTable<LAFormatType> const _laFormatTable {
     if (current != end && current->type != Token::Type::NewLine)                                   \
     UNEXPECTED_TOKEN
 
-// DataDirective: Dot + "data"
-ParserOutput Data(Iterator begin, Iterator end)
-{
-    DEFINE_CURRENT;
-
-    EXPECT_NEXT(Token::Type::Dot);
-    ADVANCE_FOR_NEXT;
-    EXPECT_WORD("data");
-
-    RESULT(DataDirData {});
-}
-
-// TextDirective: Dot + "text"
-ParserOutput Text(Iterator begin, Iterator end)
-{
-    DEFINE_CURRENT;
-
-    EXPECT_NEXT(Token::Type::Dot);
-    ADVANCE_FOR_NEXT;
-    EXPECT_WORD("text");
-
-    RESULT(TextDirData {});
-}
-
 // WordDirective: Dot + "word" + (Integer | HexInteger) + (NewLine | EOF)
-ParserOutput Word(Iterator begin, Iterator end)
+template <typename Iterator>
+ParserOutput<Iterator> WordDirective(Iterator current, Iterator end)
 {
-    DEFINE_CURRENT;
-
-    EXPECT_NEXT(Token::Type::Dot);
-    ADVANCE_FOR_NEXT;
-    EXPECT_WORD("word");
-    ADVANCE_FOR_NEXT;
     EXPECT_NEXT(Token::Type::Integer, Token::Type::HexInteger);
     uint32_t result;
     if (!GetInteger<uint32_t>(current, result))
@@ -286,278 +498,876 @@ ParserOutput Word(Iterator begin, Iterator end)
     RESULT(WordDirData { result });
 }
 
-// Label: Word + Colon
-ParserOutput Label(Iterator begin, Iterator end)
-{
-    DEFINE_CURRENT;
+// The operands of instructions are read by the parsers below, which leave `current` at the last
+// token of the operand and return nothing if it matches the grammar.
 
-    EXPECT_NEXT(Token::Type::Word);
-    auto labelName = current->value;
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Colon);
+template <typename Iterator>
+using OperandError = std::optional<CannotParse<Iterator>>;
 
-    RESULT(LabelData { labelName });
+// RegisterOperand: Dollar + (Integer | Word)
+template <typename Iterator, typename Data, auto Member>
+OperandError<Iterator> ReadOperand(
+    Iterator& current, Iterator end, Data& data, std::string_view&, RegisterOperand<Member>)
+{
+    EXPECT_REGISTER(value);
+    data.*Member = value;
+    return std::nullopt;
 }
 
-// RFormatInstruction: RFormatOpcode + Register + Register + Register + (NewLine | EOF)
-ParserOutput RFormatInstruction(Iterator begin, Iterator end)
+// IntegerOperand: Integer | HexInteger
+template <typename Iterator, typename Data, auto Member, int64_t Min, int64_t Max>
+OperandError<Iterator> ReadOperand(Iterator& current,
+                                   Iterator  end,
+                                   Data&     data,
+                                   std::string_view&,
+                                   IntegerOperand<Member, Min, Max>)
 {
-    DEFINE_CURRENT;
-
-    EXPECT_OPCODE(_rFormatTable);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(destination);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(source1);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(source2);
-    ADVANCE_FOR_NEW_LINE_OR_EOF;
+    EXPECT_IMM(value);
+    if (value < Min || Max < value)
+        UNEXPECTED_VALUE;
+    data.*Member = static_cast<MemberType<Data, Member>>(value);
+    return std::nullopt;
+}
 
-    RESULT((RFormatData { type, destination, source1, source2 }));
+// LabelOperand: Word
+template <typename Iterator, typename Data, auto Member>
+OperandError<Iterator> ReadOperand(
+    Iterator& current, Iterator end, Data&, std::string_view& label, LabelOperand<Member>)
+{
+    EXPECT_NEXT(Token::Type::Word);
+    label = current->value;
+    return std::nullopt;
 }
 
-// JRFormatInstruction: JRFormatOpcode + Register + (NewLine | EOF)
-ParserOutput JRFormatInstruction(Iterator begin, Iterator end)
+// PunctuationOperand: Comma | BracketOpen | BracketClose
+template <typename Iterator, typename Data, Token::Type Type, char Character>
+OperandError<Iterator> ReadOperand(Iterator& current,
+                                   Iterator  end,
+                                   Data&,
+                                   std::string_view&,
+                                   PunctuationOperand<Type, Character>)
 {
-    DEFINE_CURRENT;
+    EXPECT_NEXT(Type);
+    return std::nullopt;
+}
 
-    EXPECT_OPCODE(_jrFormatTable);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(source);
-    ADVANCE_FOR_NEW_LINE_OR_EOF;
+template <typename Iterator, typename Data, typename First, typename... Rest>
+OperandError<Iterator> ReadOperands(Iterator&         current,
+                                    Iterator          end,
+                                    Data&             data,
+                                    std::string_view& label,
+                                    OperandList<First, Rest...>)
+{
+    if (auto error = ReadOperand(current, end, data, label, First {}))
+        return error;
 
-    RESULT((JRFormatData { type, source }));
+    if constexpr (sizeof...(Rest) != 0)
+    {
+        ADVANCE_FOR_NEXT;
+        return ReadOperands(current, end, data, label, OperandList<Rest...> {});
+    }
+    return std::nullopt;
 }
 
-// SRFormatInstruction: SRFormatOpcode + Register + Register + (Integer | HexInteger) + (NewLine |
-// EOF)
-ParserOutput SRFormatInstruction(Iterator begin, Iterator end)
+// Instruction: Opcode + the operands of the format of the opcode + (NewLine | EOF)
+template <Format F, typename Iterator>
+ParserOutput<Iterator>
+    Instruction(Iterator current, Iterator end, uint8_t code, SymbolTable& symbols)
 {
-    DEFINE_CURRENT;
-
-    EXPECT_OPCODE(_srFormatTable);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(destination);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(source);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_IMM(shiftAmount);
-    if (shiftAmount < 0 || 32 <= shiftAmount)
-        UNEXPECTED_VALUE;
+    using Traits   = FormatTraits<F>;
+    using Operands = typename Traits::Operands;
+
+    typename Traits::Data data {};
+    std::string_view      label;
+    SetCode<F>(data, code);
+    if (auto error = ReadOperands(current, end, data, label, Operands {}))
+        return *error;
     ADVANCE_FOR_NEW_LINE_OR_EOF;
 
-    RESULT((SRFormatData { type, destination, source, static_cast<uint8_t>(shiftAmount) }));
+    // the label of an erroneous statement is not interned
+    if constexpr (HasLabel(Operands {}))
+        SetLabel(data, symbols.Intern(label), Operands {});
+    RESULT(data);
 }
 
-// IFormatInstruction: IFormatOpcode + Register + Register + (Integer | HexInteger) + (NewLine |
-// EOF)
-ParserOutput IFormatInstruction(Iterator begin, Iterator end)
+// Instructions are dispatched with a switch rather than a table of parsers so that each of them
+// can be inlined.
+#define FORMAT_CASES(CASE)                                                                         \
+    CASE(R);                                                                                       \
+    CASE(JR);                                                                                      \
+    CASE(SR);                                                                                      \
+    CASE(I);                                                                                       \
+    CASE(BI);                                                                                      \
+    CASE(II);                                                                                      \
+    CASE(OI);                                                                                      \
+    CASE(J);                                                                                       \
+    CASE(LA)
+
+// Directive: Dot + ("data" | "text" | WordDirective)
+template <typename Iterator>
+ParserOutput<Iterator> Directive(Iterator current, Iterator end)
 {
-    DEFINE_CURRENT;
-
-    EXPECT_OPCODE(_iFormatTable);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(destination);
     ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(source);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_IMM(immediate);
-    if (immediate < static_cast<int64_t>(std::numeric_limits<int16_t>::min())
-        || static_cast<int64_t>(std::numeric_limits<uint16_t>::max()) < immediate)
+    EXPECT_NEXT(Token::Type::Word);
+    auto name = FindName(current->value);
+    if (name == nullptr || !IsDirective(name->kind))
         UNEXPECTED_VALUE;
-    ADVANCE_FOR_NEW_LINE_OR_EOF;
 
-    RESULT((IFormatData { type, destination, source, static_cast<uint16_t>(immediate) }));
+    switch (name->kind)
+    {
+    case NameKind::DataDirective: RESULT(DataDirData {});
+    case NameKind::TextDirective: RESULT(TextDirData {});
+    default: break;
+    }
+
+    ADVANCE_FOR_NEXT;
+    return WordDirective(current, end);
 }
 
-// BIFormatInstruction: BIFormatOpcode + Register + Register + Word + (NewLine | EOF)
-ParserOutput BIFormatInstruction(Iterator begin, Iterator end)
+// Label: Word + Colon
+// Instruction: Opcode + the operands of the format of the opcode
+template <typename Iterator>
+ParserOutput<Iterator> LabelOrInstruction(Iterator current, Iterator end, SymbolTable& symbols)
 {
-    DEFINE_CURRENT;
-
-    EXPECT_OPCODE(_biFormatTable);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(source);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(destination);
+    auto word = current->value;
     ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Word);
-    auto target = current->value;
-    ADVANCE_FOR_NEW_LINE_OR_EOF;
+    SKIP_WHITESPACES;
 
-    RESULT((BIFormatData { type, source, destination, target }));
-}
+    // a word followed by a colon is a label even if the word is a mnemonic
+    if (current->type == Token::Type::Colon)
+        RESULT(LabelData { symbols.Intern(word) });
 
-// IIFormatInstruction: IIFormatOpcode + Register + (Integer | HexInteger) + (NewLine | EOF)
-ParserOutput IIFormatInstruction(Iterator begin, Iterator end)
-{
-    DEFINE_CURRENT;
+    // an unknown word is reported as a label without a colon
+    auto name = FindName(word);
+    if (name == nullptr || !IsInstruction(name->kind))
+        UNEXPECTED_TOKEN;
 
-    EXPECT_OPCODE(_iiFormatTable);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(destination);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_IMM(immediate);
-    if (immediate < static_cast<int64_t>(std::numeric_limits<int16_t>::min())
-        || static_cast<int64_t>(std::numeric_limits<uint16_t>::max()) < immediate)
-        UNEXPECTED_VALUE;
-    ADVANCE_FOR_NEW_LINE_OR_EOF;
+    switch (name->format)
+    {
+#define CASE(F)                                                                                    \
+    case Format::F: return Instruction<Format::F>(current, end, name->code, symbols)
+        FORMAT_CASES(CASE);
+#undef CASE
+    }
+    UNEXPECTED_TOKEN;
+}
 
-    RESULT((IIFormatData { type, destination, static_cast<uint16_t>(immediate) }));
+// Statement: Directive | Label | Instruction
+template <typename Iterator>
+ParserOutput<Iterator> Statement(Iterator current, Iterator end, SymbolTable& symbols)
+{
+    switch (current->type)
+    {
+    case Token::Type::Dot: return Directive(current, end);
+    case Token::Type::Word: return LabelOrInstruction(current, end, symbols);
+    default: UNEXPECTED_TOKEN;
+    }
 }
 
-// OIFormatInstruction: OIFormatOpcode + Register + (Integer | HexInteger) + BracketOpen + Register
-// + BracketClose + (NewLine | EOF)
-ParserOutput OIFormatInstruction(Iterator begin, Iterator end)
+/// <summary>
+/// Parses the given range of tokens and appends the results to the given result. Labels are
+/// interned in the symbol table of the result. Returns false if the number of errors reached the
+/// limit.
+/// </summary>
+template <typename Iterator>
+bool ParseTokens(Iterator            begin,
+                 Iterator const      end,
+                 ParseOptions const& options,
+                 ParseResult&        parseResult)
 {
-    DEFINE_CURRENT;
+    auto& [fragments, errors, symbols] = parseResult;
 
-    EXPECT_OPCODE(_oiFormatTable);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(operand2);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_IMM(offset);
-    if (offset < static_cast<int64_t>(std::numeric_limits<int16_t>::min())
-        || static_cast<int64_t>(std::numeric_limits<uint16_t>::max()) < offset)
-        UNEXPECTED_VALUE;
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::BracketOpen);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(operand1);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::BracketClose);
-    ADVANCE_FOR_NEW_LINE_OR_EOF;
+    while (begin != end)
+    {
+        // skip empty lines
+        Iterator current = begin;
+        while (current != end && current->type == Token::Type::Whitespace) ++current;
+        if (current == end)
+            break;
+        if (current->type == Token::Type::NewLine)
+        {
+            begin = current + 1;
+            continue;
+        }
 
-    RESULT((OIFormatData { type, operand2, static_cast<uint16_t>(offset), operand1 }));
+        auto result = Statement(current, end, symbols);
+        if (std::holds_alternative<CanParse<Iterator>>(result))
+        {
+            auto const& output = std::get<CanParse<Iterator>>(result);
+            fragments.push_back({
+                output.data,
+                { RangeOf(begin).begin, RangeOf(output.fragmentEnd - 1).end },
+            });
+            begin = output.fragmentEnd;
+        }
+        else /* if (std::holds_alternative<CannotParse<Iterator>>(result)) */
+        {
+            auto const& output = std::get<CannotParse<Iterator>>(result);
+            if (output.errorAt == end)
+            {
+                // an unexpected EOF is reported at the end of the last token
+                Position last = RangeOf(end - 1).end;
+                errors.push_back({ output.errorType, { last, last } });
+                begin = end;
+            }
+            else
+            {
+                errors.push_back({ output.errorType, RangeOf(output.errorAt) });
+
+                // the rest of the line is skipped, so the cost of an error is bounded by the
+                // length of the line
+                begin = output.errorAt;
+                while (begin != end && begin->type != Token::Type::NewLine) ++begin;
+                if (begin != end)
+                    ++begin;
+            }
+
+            if (options.maxErrors != 0 && options.maxErrors <= errors.size())
+                return false;
+        }
+    }
+
+    return true;
 }
 
-// JFormatInstruction: JFormatOpcode + Word + (NewLine | EOF)
-ParserOutput JFormatInstruction(Iterator begin, Iterator end)
+// -------------------------------------  Parallel parser -------------------------------------- //
+
+/// <summary>
+/// The minimum number of tokens a thread of <c>ParseParallel</c> takes at once, unless given.
+/// </summary>
+constexpr size_t MinChunkSize = 1 << 14;
+
+/// <summary>
+/// Splits the given number of tokens into chunks of approximately the given size, each of which
+/// ends right after a NewLine token or at the end. Returns the indices of the first tokens of the
+/// chunks, followed by the number of tokens.
+/// </summary>
+template <typename Iterator>
+std::vector<size_t> SplitIntoChunks(Iterator begin, size_t numTokens, size_t chunkSize)
 {
-    DEFINE_CURRENT;
+    std::vector<size_t> boundaries { 0 };
 
-    EXPECT_OPCODE(_jFormatTable);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Word);
-    auto target = current->value;
-    ADVANCE_FOR_NEW_LINE_OR_EOF;
+    size_t index = 0;
+    while (chunkSize < numTokens - index)
+    {
+        index += chunkSize;
+        while (index < numTokens && (begin + (index - 1))->type != Token::Type::NewLine) ++index;
+        if (index < numTokens)
+            boundaries.push_back(index);
+    }
+    boundaries.push_back(numTokens);
 
-    RESULT((JFormatData { type, target }));
+    return boundaries;
 }
 
-// LAFormatInstruction: LAFormatOpcode + Word + (NewLine | EOF)
-ParserOutput LAFormatInstruction(Iterator begin, Iterator end)
+/// <summary>
+/// Replaces the symbol IDs in the given fragment data with the IDs they are mapped to.
+/// </summary>
+void RenumberSymbols(FragmentData& data, std::vector<SymbolId> const& ids) noexcept
 {
-    DEFINE_CURRENT;
+    if (auto label = std::get_if<LabelData>(&data))
+        label->symbol = ids[label->symbol];
+    else if (auto branch = std::get_if<BIFormatData>(&data))
+        branch->target = ids[branch->target];
+    else if (auto jump = std::get_if<JFormatData>(&data))
+        jump->target = ids[jump->target];
+    else if (auto address = std::get_if<LAFormatData>(&data))
+        address->target = ids[address->target];
+}
 
-    EXPECT_OPCODE(_laFormatTable);
-    ADVANCE_FOR_NEXT;
-    EXPECT_REGISTER(destination);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Comma);
-    ADVANCE_FOR_NEXT;
-    EXPECT_NEXT(Token::Type::Word);
-    auto target = current->value;
-    ADVANCE_FOR_NEW_LINE_OR_EOF;
+/// <summary>
+/// Parses the given number of tokens using multiple threads.
+/// </summary>
+template <typename Iterator>
+ParseResult ParseTokensParallel(Iterator               begin,
+                                size_t                 numTokens,
+                                ParseOptions const&    options,
+                                ParallelOptions const& parallelOptions)
+{
+    ParseResult result;
+
+    size_t              numThreads = GetNumThreads(parallelOptions);
+    std::vector<size_t> boundaries;
+    if (numThreads > 1)
+    {
+        size_t chunkSize = parallelOptions.chunkSize;
+        if (chunkSize == 0)
+            chunkSize = std::max(numTokens / (numThreads * 4), MinChunkSize);
+        boundaries = SplitIntoChunks(begin, numTokens, chunkSize);
+    }
+
+    if (boundaries.size() <= 2)
+    {
+        ParseTokens(begin, begin + numTokens, options, result);
+        return result;
+    }
+
+    // A statement never continues after a NewLine token, so each chunk is parsed exactly as in the
+    // serial version.
+    size_t                   numChunks = boundaries.size() - 1;
+    std::vector<ParseResult> results(numChunks);
+    ParallelFor(numChunks, numThreads, [&](size_t i) {
+        ParseTokens(begin + boundaries[i], begin + boundaries[i + 1], options, results[i]);
+    });
+
+    // If the number of errors reaches the limit, the chunk where it happens is parsed again with
+    // the remaining number of errors, so that it stops at the same statement as the serial version.
+    size_t numFragments = 0;
+    size_t numErrors    = 0;
+    for (size_t i = 0; i < numChunks; ++i)
+    {
+        if (options.maxErrors != 0 && options.maxErrors <= numErrors + results[i].errors.size())
+        {
+            ParseOptions remaining = options;
+            remaining.maxErrors -= numErrors;
+
+            results[i] = {};
+            ParseTokens(begin + boundaries[i], begin + boundaries[i + 1], remaining, results[i]);
+            numChunks = i + 1;
+        }
+
+        numFragments += results[i].fragments.size();
+        numErrors += results[i].errors.size();
+    }
+
+    // Each chunk numbers its symbols in the order they first appear in it. Interning the names of
+    // the chunks in chunk order gives the IDs the serial version assigns.
+    std::vector<std::vector<SymbolId>> symbolIds(numChunks);
+    for (size_t i = 0; i < numChunks; ++i)
+    {
+        auto const& symbols = results[i].symbols;
+        symbolIds[i].resize(symbols.size());
+        for (SymbolId id = 0; id < symbols.size(); ++id)
+            symbolIds[i][id] = result.symbols.Intern(symbols.GetName(id));
+    }
 
-    RESULT((LAFormatData { type, destination, target }));
-}
-
-Parser _parsers[] = {
-    Data,
-    Text,
-    Word,
-    Label,
-    RFormatInstruction,
-    JRFormatInstruction,
-    SRFormatInstruction,
-    IFormatInstruction,
-    BIFormatInstruction,
-    IIFormatInstruction,
-    OIFormatInstruction,
-    JFormatInstruction,
-    LAFormatInstruction,
+    std::vector<size_t> fragmentOffsets(numChunks);
+    for (size_t i = 1; i < numChunks; ++i)
+        fragmentOffsets[i] = fragmentOffsets[i - 1] + results[i - 1].fragments.size();
+
+    result.fragments.resize(numFragments);
+    ParallelFor(numChunks, numThreads, [&](size_t i) {
+        auto output = result.fragments.begin() + fragmentOffsets[i];
+        for (auto const& fragment : results[i].fragments)
+        {
+            *output = fragment;
+            RenumberSymbols(output->data, symbolIds[i]);
+            ++output;
+        }
+    });
+
+    result.errors.reserve(numErrors);
+    for (size_t i = 0; i < numChunks; ++i)
+    {
+        auto const& errors = results[i].errors;
+        result.errors.insert(result.errors.end(), errors.begin(), errors.end());
+    }
+
+    return result;
+}
+
+// ---------------------------------------  Code parser ---------------------------------------- //
+
+/// <summary>
+/// Represents the properties of a byte which the code parser reads.
+/// </summary>
+enum ByteFlags : uint8_t
+{
+    SpaceByte     = 1 << 0, // whitespaces except for \n
+    DelimiterByte = 1 << 1, // whitespaces (including \n) and .:$(),
+    WordStartByte = 1 << 2, // [a-zA-Z_]
+    WordByte      = 1 << 3, // [0-9a-zA-Z_]
+    DigitByte     = 1 << 4, // [0-9]
+    HexDigitByte  = 1 << 5, // [0-9a-fA-F]
 };
 
-Iterator SkipEmptyLine(Iterator begin, Iterator end)
+constexpr uint8_t ClassifyByte(unsigned char c) noexcept
 {
-    Iterator current = begin;
-    while (current != end && current->type == Token::Type::Whitespace) ++current;
-    if (current != end && current->type != Token::Type::NewLine)
-        return begin;
-    return current == end ? current : current + 1;
+    bool isSpace     = c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r';
+    bool isDigit     = '0' <= c && c <= '9';
+    bool isHexLetter = ('a' <= c && c <= 'f') || ('A' <= c && c <= 'F');
+    bool isLetter    = ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+
+    uint8_t flags = 0;
+    if (isSpace)
+        flags |= SpaceByte;
+    if (isSpace || c == '\n' || c == '.' || c == ':' || c == '$' || c == '(' || c == ')'
+        || c == ',')
+        flags |= DelimiterByte;
+    if (isLetter || c == '_')
+        flags |= WordStartByte;
+    if (isDigit || isLetter || c == '_')
+        flags |= WordByte;
+    if (isDigit)
+        flags |= DigitByte;
+    if (isDigit || isHexLetter)
+        flags |= HexDigitByte;
+    return flags;
 }
 
+constexpr std::array<uint8_t, 256> MakeByteFlagTable() noexcept
+{
+    std::array<uint8_t, 256> table {};
+    for (size_t c = 0; c < table.size(); ++c)
+        table[c] = ClassifyByte(static_cast<unsigned char>(c));
+    return table;
 }
 
-ParseResult Parse(std::vector<Token> const& tokens)
+constexpr std::array<uint8_t, 256> _byteFlags = MakeByteFlagTable();
+
+/// <summary>
+/// Parses fragments directly from the bytes of the code, line by line. A line the byte-level
+/// grammar does not accept, including every line with an error, is tokenized and parsed by
+/// <c>ParseTokens</c> instead, so the result is the same as that of <c>Tokenize</c> and
+/// <c>Parse</c>.
+/// </summary>
+class CodeParser
 {
-    std::vector<Fragment>     fragments;
-    std::vector<ParsingError> errors;
+  public:
+    CodeParser(std::string_view           code,
+               TokenizationOptions const& tokenizationOptions,
+               ParseOptions const&        options,
+               CodeParseResult&           result) noexcept :
+        _code { code },
+        _tokenizationOptions { tokenizationOptions },
+        _options { options },
+        _tokenizationErrors { result.tokenizationErrors },
+        _result { result.parseResult }
+    {}
+
+  public:
+    /// <summary>
+    /// Parses the code, calling <c>onLine()</c> after each line.
+    /// </summary>
+    template <typename LineHandler>
+    void Run(LineHandler&& onLine)
+    {
+        char const* const codeEnd = _code.data() + _code.size();
 
-    auto       begin = tokens.begin();
-    auto const end   = tokens.end();
+        _lineBegin = _code.data();
+        _line      = 1;
+        while (_lineBegin < codeEnd)
+        {
+            auto newLine = static_cast<char const*>(
+                std::memchr(_lineBegin, '\n', codeEnd - _lineBegin));
+            _lineEnd    = newLine ? newLine : codeEnd;
+            _hasNewLine = newLine != nullptr;
+
+            bool canContinue = ParseLine() || ParseLineWithTokens();
+            onLine();
+            if (!canContinue)
+                break;
 
-    while (begin != end)
+            _lineBegin = _lineEnd + 1;
+            ++_line;
+        }
+    }
+
+  private:
+    /// <summary>
+    /// Parses the current line with the byte-level grammar. Returns false without adding any
+    /// fragments if the line does not match the grammar.
+    /// </summary>
+    bool ParseLine()
     {
-        ParsingError::Type errorType;
-        Iterator           maxErrorAt = begin;
-        bool               parsed     = false;
-        for (auto parser : _parsers)
+        size_t numFragments = _result.fragments.size();
+
+        _current = _lineBegin;
+        while (true)
         {
-            auto result = parser(begin, end);
-            if (std::holds_alternative<CanParse>(result))
-            {
-                auto const& output = std::get<CanParse>(result);
-                fragments.push_back(
-                    { output.data, { begin->range.begin, output.fragmentEnd[-1].range.end } });
-                begin  = output.fragmentEnd;
-                parsed = true;
-                break;
-            }
-            else /* if (std::holds_alternative<CannotParse>(result)) */
+            char const* statementBegin = _current;
+            SkipSpaces();
+            if (AtLineEnd())
+                return true;
+
+            // the range of a statement includes the whitespaces before it if they are tokens
+            Position begin
+                = PositionOf(_tokenizationOptions.elideWhitespaces ? _current : statementBegin);
+
+            bool parsed = *_current == '.' ? ParseDirective(begin) : ParseLabelOrInstruction(begin);
+            if (!parsed)
             {
-                auto const& output = std::get<CannotParse>(result);
-                if (maxErrorAt <= output.errorAt)
-                {
-                    maxErrorAt = output.errorAt;
-                    errorType  = output.errorType;
-                }
+                // the symbols interned so far are also interned by ParseTokens in the same order
+                _result.fragments.resize(numFragments);
+                return false;
             }
         }
+    }
 
-        if (!parsed)
+    /// <summary>
+    /// Tokenizes the current line and parses the tokens. Returns false if the number of errors
+    /// reached the limit.
+    /// </summary>
+    bool ParseLineWithTokens()
+    {
+        auto line = std::string_view(_lineBegin, _lineEnd - _lineBegin + (_hasNewLine ? 1 : 0));
+        auto tokenizationResult
+            = Tokenize(line, _tokenizationOptions, _result.fragments.get_allocator().resource());
+
+        uint32_t numLinesAbove = _line - 1;
+        auto     moveDown      = [numLinesAbove](Range& range) {
+            range.begin.line += numLinesAbove;
+            range.end.line += numLinesAbove;
+        };
+        for (auto& token : tokenizationResult.tokens) moveDown(token.range);
+        for (auto& error : tokenizationResult.errors)
         {
-            auto emptyLineSkipResult = SkipEmptyLine(begin, end);
-            if (emptyLineSkipResult == begin)
-            {
-                errors.push_back({ errorType, maxErrorAt->range });
-                begin = maxErrorAt + 1;
-            }
-            else
-                begin = emptyLineSkipResult;
+            moveDown(error.range);
+            _tokenizationErrors.push_back(error);
+        }
+
+        auto const& tokens = tokenizationResult.tokens;
+        return ParseTokens(tokens.cbegin(), tokens.cend(), _options, _result);
+    }
+
+    // Directive: Dot + ("data" | "text" | "word" + (Integer | HexInteger) + (NewLine | EOF))
+    bool ParseDirective(Position begin)
+    {
+        ++_current;
+
+        std::string_view name;
+        if (!ReadWord(name))
+            return false;
+
+        auto entry = FindName(name);
+        if (entry == nullptr || !IsDirective(entry->kind))
+            return false;
+
+        switch (entry->kind)
+        {
+        case NameKind::DataDirective: return Append(DataDirData {}, begin);
+        case NameKind::TextDirective: return Append(TextDirData {}, begin);
+        default: break;
+        }
+
+        uint32_t value;
+        return ReadInteger(value, true) && AppendLine(WordDirData { value }, begin);
+    }
+
+    // Label: Word + Colon
+    // Instruction: Opcode + the operands of the format of the opcode + (NewLine | EOF)
+    bool ParseLabelOrInstruction(Position begin)
+    {
+        std::string_view word;
+        if (!ReadWord(word))
+            return false;
+        if (ReadCharacter(':'))
+            return Append(LabelData { _result.symbols.Intern(word) }, begin);
+
+        auto entry = FindName(word);
+        if (entry == nullptr || !IsInstruction(entry->kind))
+            return false;
+
+        switch (entry->format)
+        {
+#define CASE(F)                                                                                    \
+    case Format::F: return ParseInstruction<Format::F>(entry->code, begin)
+            FORMAT_CASES(CASE);
+#undef CASE
+        }
+        return false;
+    }
+
+    template <Format F>
+    bool ParseInstruction(uint8_t code, Position begin)
+    {
+        using Traits   = FormatTraits<F>;
+        using Operands = typename Traits::Operands;
+
+        typename Traits::Data data {};
+        std::string_view      label;
+        SetCode<F>(data, code);
+        if (!ReadOperands(data, label, Operands {}))
+            return false;
+
+        if constexpr (HasLabel(Operands {}))
+        {
+            if (!AtStatementEnd())
+                return false;
+            SetLabel(data, _result.symbols.Intern(label), Operands {});
         }
+        return AppendLine(data, begin);
+    }
+
+  private:
+    Position PositionOf(char const* at) const noexcept
+    {
+        return Position { _line, static_cast<uint32_t>(at - _lineBegin + 1) };
+    }
+
+    bool Is(char c, uint8_t flags) const noexcept
+    {
+        return (_byteFlags[static_cast<unsigned char>(c)] & flags) != 0;
+    }
+
+    void SkipSpaces() noexcept
+    {
+        while (_current != _lineEnd && Is(*_current, SpaceByte)) ++_current;
+    }
+
+    // Checks whether only whitespaces and a comment can follow.
+    bool AtLineEnd() const noexcept
+    {
+        return _current == _lineEnd || (*_current == '#' && _tokenizationOptions.skipComments);
+    }
+
+    // Checks whether only whitespaces and a comment follow, without moving. A label must not be
+    // interned before this holds, since ParseTokens does not intern the labels of erroneous
+    // statements.
+    bool AtStatementEnd() const noexcept
+    {
+        char const* at = _current;
+        while (at != _lineEnd && Is(*at, SpaceByte)) ++at;
+        return at == _lineEnd || (*at == '#' && _tokenizationOptions.skipComments);
+    }
+
+    // Checks whether a complex token ends at the current position.
+    bool AtDelimiter() const noexcept
+    {
+        return AtLineEnd() || Is(*_current, DelimiterByte);
+    }
+
+    bool ReadCharacter(char c) noexcept
+    {
+        SkipSpaces();
+        if (_current == _lineEnd || *_current != c)
+            return false;
+
+        ++_current;
+        return true;
+    }
+
+    bool ReadWord(std::string_view& output) noexcept
+    {
+        SkipSpaces();
+        if (_current == _lineEnd || !Is(*_current, WordStartByte))
+            return false;
+
+        char const* begin = _current++;
+        while (_current != _lineEnd && Is(*_current, WordByte)) ++_current;
+        if (!AtDelimiter())
+            return false;
+
+        output = std::string_view(begin, _current - begin);
+        return true;
+    }
+
+    template <typename T>
+    bool ReadInteger(T& output, bool allowHex) noexcept
+    {
+        SkipSpaces();
+        if (_current == _lineEnd)
+            return false;
+
+        char const* begin = _current;
+        int         base  = 10;
+        uint8_t     body  = DigitByte;
+        if (allowHex && *_current == '0' && _current + 1 != _lineEnd && _current[1] == 'x')
+        {
+            begin    = _current + 2;
+            base     = 16;
+            body     = HexDigitByte;
+            _current = begin;
+        }
+        else if (Is(*_current, DigitByte) || *_current == '-')
+            ++_current;
+        else
+            return false;
+
+        while (_current != _lineEnd && Is(*_current, body)) ++_current;
+        if (!AtDelimiter())
+            return false;
+
+        return std::from_chars(begin, _current, output, base).ec == std::errc {};
+    }
+
+    bool ReadRegister(uint8_t& output) noexcept
+    {
+        if (!ReadCharacter('$'))
+            return false;
+
+        SkipSpaces();
+        if (_current == _lineEnd || !Is(*_current, WordStartByte))
+            return ReadInteger(output, false) && output < NumRegisters;
+
+        std::string_view name;
+        if (!ReadWord(name))
+            return false;
+
+        auto entry = FindName(name);
+        if (entry == nullptr || entry->kind != NameKind::Register)
+            return false;
+
+        output = entry->code;
+        return true;
     }
 
-    return { std::move(fragments), std::move(errors) };
+    template <typename Data, auto Member>
+    bool ReadOperand(Data& data, std::string_view&, RegisterOperand<Member>) noexcept
+    {
+        return ReadRegister(data.*Member);
+    }
+
+    template <typename Data, auto Member, int64_t Min, int64_t Max>
+    bool ReadOperand(Data& data, std::string_view&, IntegerOperand<Member, Min, Max>) noexcept
+    {
+        int64_t value;
+        if (!ReadInteger(value, true) || value < Min || Max < value)
+            return false;
+
+        data.*Member = static_cast<MemberType<Data, Member>>(value);
+        return true;
+    }
+
+    template <typename Data, auto Member>
+    bool ReadOperand(Data&, std::string_view& label, LabelOperand<Member>) noexcept
+    {
+        return ReadWord(label);
+    }
+
+    template <typename Data, Token::Type Type, char Character>
+    bool ReadOperand(Data&, std::string_view&, PunctuationOperand<Type, Character>) noexcept
+    {
+        return ReadCharacter(Character);
+    }
+
+    template <typename Data, typename... Operands>
+    bool ReadOperands(Data& data, std::string_view& label, OperandList<Operands...>) noexcept
+    {
+        return (ReadOperand(data, label, Operands {}) && ...);
+    }
+
+    // Appends a fragment which ends at the current position.
+    template <typename Data>
+    bool Append(Data const& data, Position begin)
+    {
+        _result.fragments.push_back({ data, { begin, PositionOf(_current) } });
+        return true;
+    }
+
+    // Appends a fragment which ends with the line.
+    template <typename Data>
+    bool AppendLine(Data const& data, Position begin)
+    {
+        char const* lastTokenEnd = _current;
+        SkipSpaces();
+        if (!AtLineEnd())
+            return false;
+        if (!_tokenizationOptions.elideWhitespaces)
+            lastTokenEnd = _current;
+
+        Position end = _hasNewLine ? PositionOf(_lineEnd).NextLine() : PositionOf(lastTokenEnd);
+        _result.fragments.push_back({ data, { begin, end } });
+        _current = _lineEnd;
+        return true;
+    }
+
+  private:
+    std::string_view                     _code;
+    TokenizationOptions const&           _tokenizationOptions;
+    ParseOptions const&                  _options;
+    std::pmr::vector<TokenizationError>& _tokenizationErrors;
+    ParseResult&                         _result;
+
+    char const* _lineBegin  = nullptr;
+    char const* _lineEnd    = nullptr;
+    char const* _current    = nullptr;
+    uint32_t    _line       = 1;
+    bool        _hasNewLine = false;
+};
+
+}
+
+SymbolId SymbolTable::Intern(std::string_view name)
+{
+    auto [it, inserted] = _ids.try_emplace(name, static_cast<SymbolId>(_names.size()));
+    if (inserted)
+        _names.push_back(name);
+    return it->second;
+}
+
+ParseResult Parse(std::pmr::vector<Token> const& tokens,
+                  ParseOptions const&            options,
+                  std::pmr::memory_resource*     resource)
+{
+    ParseResult result { resource };
+    ParseTokens(tokens.begin(), tokens.end(), options, result);
+    return result;
+}
+
+ParseResult Parse(std::vector<Token> const&  tokens,
+                  ParseOptions const&        options,
+                  std::pmr::memory_resource* resource)
+{
+    ParseResult result { resource };
+    ParseTokens(tokens.begin(), tokens.end(), options, result);
+    return result;
+}
+
+ParseResult Parse(TokenBuffer const& tokens, ParseOptions const& options)
+{
+    ParseResult result;
+    ParseTokens(
+        CompactIterator { tokens, 0 }, CompactIterator { tokens, tokens.size() }, options, result);
+    return result;
+}
+
+ParseResult Parse(TokenStream& tokens, ParseOptions const& options)
+{
+    ParseResult result;
+
+    // A statement never continues after a NewLine token, so parsing line by line is identical to
+    // parsing the whole array of tokens at once.
+    std::vector<Token> line;
+    while (tokens.NextLine(line))
+    {
+        if (!ParseTokens(line.cbegin(), line.cend(), options, result))
+            break;
+    }
+
+    return result;
+}
+
+ParseResult ParseParallel(std::pmr::vector<Token> const& tokens,
+                          ParseOptions const&            options,
+                          ParallelOptions const&         parallelOptions)
+{
+    return ParseTokensParallel(tokens.cbegin(), tokens.size(), options, parallelOptions);
+}
+
+ParseResult ParseParallel(std::vector<Token> const& tokens,
+                          ParseOptions const&       options,
+                          ParallelOptions const&    parallelOptions)
+{
+    return ParseTokensParallel(tokens.cbegin(), tokens.size(), options, parallelOptions);
+}
+
+ParseResult ParseParallel(TokenBuffer const&     tokens,
+                          ParseOptions const&    options,
+                          ParallelOptions const& parallelOptions)
+{
+    return ParseTokensParallel(
+        CompactIterator { tokens, 0 }, tokens.size(), options, parallelOptions);
+}
+
+CodeParseResult ParseCode(std::string_view           code,
+                          TokenizationOptions const& tokenizationOptions,
+                          ParseOptions const&        options,
+                          std::pmr::memory_resource* resource)
+{
+    CodeParseResult result { resource };
+    CodeParser { code, tokenizationOptions, options, result }.Run([] {});
+    return result;
+}
+
+CodeParseResult ParseCode(std::string_view                         code,
+                          TokenizationOptions const&               tokenizationOptions,
+                          ParseOptions const&                      options,
+                          std::function<void(ParseResult&)> const& onLine,
+                          std::pmr::memory_resource*               resource)
+{
+    CodeParseResult result { resource };
+    CodeParser { code, tokenizationOptions, options, result }.Run(
+        [&] { onLine(result.parseResult); });
+    return result;
 }
@@ -0,0 +1,136 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SIMPLE_MIPS_ASM_REGISTER_USE_HH
+#define SIMPLE_MIPS_ASM_REGISTER_USE_HH
+
+#include <simple-mips-asm/Parsing.hh>
+
+#include <cstdint>
+#include <variant>
+
+/// <summary>
+/// Represents the registers an instruction reads and writes, as masks whose bits are indexed by
+/// the register numbers. $0 is never in a mask, since writing it has no effect and reading it has
+/// no dependency.
+/// </summary>
+struct RegisterUse
+{
+    uint32_t reads   = 0;
+    uint32_t writes  = 0;
+    bool     isLoad  = false;
+    bool     isStore = false;
+};
+
+/// <summary>
+/// Returns the mask of the given register.
+/// </summary>
+constexpr uint32_t MaskOfRegister(uint8_t reg) noexcept
+{
+    return reg == 0 ? 0 : uint32_t(1) << reg;
+}
+
+inline RegisterUse UseOf(RFormatData const& data) noexcept
+{
+    return {
+        MaskOfRegister(data.source1) | MaskOfRegister(data.source2),
+        MaskOfRegister(data.destination),
+    };
+}
+
+inline RegisterUse UseOf(JRFormatData const& data) noexcept
+{
+    return { MaskOfRegister(data.source), 0 };
+}
+
+inline RegisterUse UseOf(SRFormatData const& data) noexcept
+{
+    return { MaskOfRegister(data.source), MaskOfRegister(data.destination) };
+}
+
+inline RegisterUse UseOf(IFormatData const& data) noexcept
+{
+    return { MaskOfRegister(data.source), MaskOfRegister(data.destination) };
+}
+
+inline RegisterUse UseOf(BIFormatData const& data) noexcept
+{
+    return { MaskOfRegister(data.source) | MaskOfRegister(data.destination), 0 };
+}
+
+inline RegisterUse UseOf(IIFormatData const& data) noexcept
+{
+    return { 0, MaskOfRegister(data.destination) };
+}
+
+inline RegisterUse UseOf(OIFormatData const& data) noexcept
+{
+    // operand1 is the base, and operand2 is the destination of a load or the value of a store
+    if (data.operation == OIFormatOperation::LB || data.operation == OIFormatOperation::LW)
+        return { MaskOfRegister(data.operand1), MaskOfRegister(data.operand2), true };
+    return { MaskOfRegister(data.operand1) | MaskOfRegister(data.operand2), 0, false, true };
+}
+
+inline RegisterUse UseOf(JFormatData const& data) noexcept
+{
+    constexpr uint8_t returnAddress = 31;
+    return { 0, data.operation == JFormatOperation::JAL ? MaskOfRegister(returnAddress) : 0 };
+}
+
+inline RegisterUse UseOf(LAFormatData const& data) noexcept
+{
+    return { 0, MaskOfRegister(data.destination) };
+}
+
+// directives and labels
+template <typename Data>
+RegisterUse UseOf(Data const&) noexcept
+{
+    return {};
+}
+
+inline RegisterUse UseOf(FragmentData const& data) noexcept
+{
+    return std::visit([](auto const& data) { return UseOf(data); }, data);
+}
+
+/// <summary>
+/// Returns the registers the given instruction loads, which stall the instruction after it if it
+/// reads them.
+/// </summary>
+inline uint32_t LoadedBy(RegisterUse use) noexcept
+{
+    return use.isLoad ? use.writes : 0;
+}
+
+/// <summary>
+/// Returns whether the given fragment is an instruction, which is not a label or a directive.
+/// </summary>
+inline bool IsInstruction(FragmentData const& data) noexcept
+{
+    return !std::holds_alternative<LabelData>(data) && !std::holds_alternative<DataDirData>(data)
+           && !std::holds_alternative<TextDirData>(data)
+           && !std::holds_alternative<WordDirData>(data);
+}
+
+/// <summary>
+/// Returns whether the given fragment is a branch or a jump, which has a delay slot on a target
+/// with delay slots.
+/// </summary>
+inline bool IsControlTransfer(FragmentData const& data) noexcept
+{
+    return std::holds_alternative<BIFormatData>(data) || std::holds_alternative<JFormatData>(data)
+           || std::holds_alternative<JRFormatData>(data);
+}
+
+/// <summary>
+/// Returns whether the given fragment is nop, which is sll $0, $0, 0.
+/// </summary>
+inline bool IsNop(FragmentData const& data) noexcept
+{
+    auto shift = std::get_if<SRFormatData>(&data);
+    return shift && shift->function == SRFormatFunction::SLL && shift->destination == 0
+           && shift->source == 0 && shift->shiftAmount == 0;
+}
+
+#endif
@@ -0,0 +1,207 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <simple-mips-asm/Scanning.hh>
+
+#include "CpuFeatures.hh"
+#include <cstring>
+
+namespace
+{
+
+// ------------------------------------------ Scalar ------------------------------------------- //
+
+BlockMasks ScanBlockScalar(char const* block) noexcept
+{
+    BlockMasks masks {};
+    for (size_t i = 0; i < BlockSize; ++i)
+    {
+        auto     c   = static_cast<unsigned char>(block[i]);
+        auto     l   = static_cast<unsigned char>(c | 0x20);
+        uint64_t bit = uint64_t(1) << i;
+
+        bool isNewLine    = c == '\n';
+        bool isWhitespace = c == ' ' || (c - 0x09u <= 0x04u && c != '\n');
+        bool isDigit      = unsigned(c - '0') <= 9u;
+        bool isHexLetter  = unsigned(l - 'a') <= 5u;
+        bool isLetter     = unsigned(l - 'a') <= 25u;
+
+        if (isNewLine)
+            masks.newLines |= bit;
+        if (isNewLine || isWhitespace || c == '.' || c == ':' || c == '$' || c == '(' || c == ')'
+            || c == ',')
+            masks.delimiters |= bit;
+        if (isWhitespace)
+            masks.whitespaces |= bit;
+        if (isDigit)
+            masks.digits |= bit;
+        if (isDigit || isHexLetter)
+            masks.hexDigits |= bit;
+        if (isDigit || isLetter || c == '_')
+            masks.wordCharacters |= bit;
+        if (c == '#')
+            masks.hashes |= bit;
+    }
+    return masks;
+}
+
+#ifdef SIMPLE_MIPS_ASM_X64
+
+// ------------------------------------------- SSE2 -------------------------------------------- //
+
+// Returns 0xFF in each byte where x <= max when both are treated as unsigned.
+inline __m128i LessEqualU8(__m128i x, __m128i max) noexcept
+{
+    return _mm_cmpeq_epi8(_mm_min_epu8(x, max), x);
+}
+
+inline __m128i InRange(__m128i x, char low, char count) noexcept
+{
+    return LessEqualU8(_mm_sub_epi8(x, _mm_set1_epi8(low)), _mm_set1_epi8(count));
+}
+
+inline __m128i Equal(__m128i x, char c) noexcept
+{
+    return _mm_cmpeq_epi8(x, _mm_set1_epi8(c));
+}
+
+BlockMasks ScanBlockSSE2(char const* block) noexcept
+{
+    BlockMasks masks {};
+    for (size_t i = 0; i < BlockSize; i += 16)
+    {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(block + i));
+        __m128i l = _mm_or_si128(c, _mm_set1_epi8(0x20));
+
+        __m128i newLines    = Equal(c, '\n');
+        __m128i whitespaces = _mm_or_si128(Equal(c, ' '),
+                                           _mm_andnot_si128(newLines, InRange(c, 0x09, 0x04)));
+        __m128i digits      = InRange(c, '0', 9);
+        __m128i hexDigits   = _mm_or_si128(digits, InRange(l, 'a', 5));
+        __m128i words
+            = _mm_or_si128(_mm_or_si128(digits, InRange(l, 'a', 25)), Equal(c, '_'));
+        __m128i symbols = _mm_or_si128(
+            _mm_or_si128(_mm_or_si128(Equal(c, '.'), Equal(c, ':')), Equal(c, '$')),
+            _mm_or_si128(_mm_or_si128(Equal(c, '('), Equal(c, ')')), Equal(c, ',')));
+        __m128i delimiters = _mm_or_si128(_mm_or_si128(newLines, whitespaces), symbols);
+
+        auto toMask = [](__m128i v) {
+            return static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(v)));
+        };
+
+        masks.newLines |= toMask(newLines) << i;
+        masks.delimiters |= toMask(delimiters) << i;
+        masks.whitespaces |= toMask(whitespaces) << i;
+        masks.digits |= toMask(digits) << i;
+        masks.hexDigits |= toMask(hexDigits) << i;
+        masks.wordCharacters |= toMask(words) << i;
+        masks.hashes |= toMask(Equal(c, '#')) << i;
+    }
+    return masks;
+}
+
+// ------------------------------------------- AVX2 -------------------------------------------- //
+
+SIMPLE_MIPS_ASM_TARGET_AVX2 inline __m256i LessEqualU8(__m256i x, __m256i max) noexcept
+{
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(x, max), x);
+}
+
+SIMPLE_MIPS_ASM_TARGET_AVX2 inline __m256i InRange(__m256i x, char low, char count) noexcept
+{
+    return LessEqualU8(_mm256_sub_epi8(x, _mm256_set1_epi8(low)), _mm256_set1_epi8(count));
+}
+
+SIMPLE_MIPS_ASM_TARGET_AVX2 inline __m256i Equal(__m256i x, char c) noexcept
+{
+    return _mm256_cmpeq_epi8(x, _mm256_set1_epi8(c));
+}
+
+SIMPLE_MIPS_ASM_TARGET_AVX2 BlockMasks ScanBlockAVX2(char const* block) noexcept
+{
+    BlockMasks masks {};
+    for (size_t i = 0; i < BlockSize; i += 32)
+    {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(block + i));
+        __m256i l = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+
+        __m256i newLines    = Equal(c, '\n');
+        __m256i whitespaces = _mm256_or_si256(
+            Equal(c, ' '), _mm256_andnot_si256(newLines, InRange(c, 0x09, 0x04)));
+        __m256i digits    = InRange(c, '0', 9);
+        __m256i hexDigits = _mm256_or_si256(digits, InRange(l, 'a', 5));
+        __m256i words
+            = _mm256_or_si256(_mm256_or_si256(digits, InRange(l, 'a', 25)), Equal(c, '_'));
+        __m256i symbols = _mm256_or_si256(
+            _mm256_or_si256(_mm256_or_si256(Equal(c, '.'), Equal(c, ':')), Equal(c, '$')),
+            _mm256_or_si256(_mm256_or_si256(Equal(c, '('), Equal(c, ')')), Equal(c, ',')));
+        __m256i delimiters = _mm256_or_si256(_mm256_or_si256(newLines, whitespaces), symbols);
+
+        auto toMask = [](__m256i v) SIMPLE_MIPS_ASM_TARGET_AVX2 {
+            return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(v)));
+        };
+
+        masks.newLines |= toMask(newLines) << i;
+        masks.delimiters |= toMask(delimiters) << i;
+        masks.whitespaces |= toMask(whitespaces) << i;
+        masks.digits |= toMask(digits) << i;
+        masks.hexDigits |= toMask(hexDigits) << i;
+        masks.wordCharacters |= toMask(words) << i;
+        masks.hashes |= toMask(Equal(c, '#')) << i;
+    }
+    return masks;
+}
+
+#endif
+
+}
+
+ScannerKind DetectScannerKind() noexcept
+{
+#ifdef SIMPLE_MIPS_ASM_X64
+    static ScannerKind const kind = IsAVX2Supported() ? ScannerKind::AVX2 : ScannerKind::SSE2;
+    return kind;
+#else
+    return ScannerKind::Scalar;
+#endif
+}
+
+BlockScanner GetBlockScanner(ScannerKind kind) noexcept
+{
+    switch (kind)
+    {
+#ifdef SIMPLE_MIPS_ASM_X64
+    case ScannerKind::SSE2: return ScanBlockSSE2;
+    case ScannerKind::AVX2: return IsAVX2Supported() ? ScanBlockAVX2 : ScanBlockSSE2;
+#endif
+    default: return ScanBlockScalar;
+    }
+}
+
+BlockScanner GetBlockScanner() noexcept
+{
+    static BlockScanner const scanner = GetBlockScanner(DetectScannerKind());
+    return scanner;
+}
+
+BlockMasks ScanPartialBlock(BlockScanner scanner, std::string_view bytes) noexcept
+{
+    char block[BlockSize];
+    std::memset(block, ' ', BlockSize);
+    std::memcpy(block, bytes.data(), bytes.size() < BlockSize ? bytes.size() : BlockSize);
+    return scanner(block);
+}
+
+size_t CountNewLines(std::string_view code) noexcept
+{
+    BlockScanner scanner = GetBlockScanner();
+
+    size_t count  = 0;
+    size_t offset = 0;
+    for (; offset + BlockSize <= code.size(); offset += BlockSize)
+        count += PopCount(scanner(code.data() + offset).newLines);
+    if (offset < code.size())
+        count += PopCount(ScanPartialBlock(scanner, code.substr(offset)).newLines);
+
+    return count;
+}
@@ -0,0 +1,426 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <simple-mips-asm/Scheduling.hh>
+
+#include "RegisterUse.hh"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <variant>
+
+namespace
+{
+
+// ---------------------------------------  Delay slots ---------------------------------------- //
+
+/// <summary>
+/// Returns whether the given fragment is an instruction which can be in a delay slot. Control
+/// transfers cannot be in delay slots, and an la may be two words.
+/// </summary>
+bool IsMovable(FragmentData const& data) noexcept
+{
+    return std::holds_alternative<RFormatData>(data) || std::holds_alternative<SRFormatData>(data)
+           || std::holds_alternative<IFormatData>(data)
+           || std::holds_alternative<IIFormatData>(data)
+           || std::holds_alternative<OIFormatData>(data);
+}
+
+/// <summary>
+/// Returns whether the given instruction can run after the given branch or jump instead of before
+/// it. The branch reads its operands before the instruction, and a jal writes $ra before it.
+/// </summary>
+bool IsIndependent(RegisterUse instruction, RegisterUse transfer) noexcept
+{
+    return (instruction.writes & transfer.reads) == 0
+           && ((instruction.reads | instruction.writes) & transfer.writes) == 0;
+}
+
+// ------------------------------------  Load-use hazards -------------------------------------- //
+
+/// <summary>
+/// Returns whether the given fragment is an instruction which can be reordered in a basic block.
+/// </summary>
+bool IsSchedulable(FragmentData const& data) noexcept
+{
+    return IsMovable(data) || std::holds_alternative<LAFormatData>(data);
+}
+
+/// <summary>
+/// List-schedules basic blocks. The dependency graph of a block has an edge from an instruction to
+/// each instruction which must stay after it, and since the edges follow the original order, an
+/// instruction only depends on the instructions before it. The buffers are reused for every block.
+/// </summary>
+class BlockScheduler
+{
+  public:
+    explicit BlockScheduler(std::pmr::memory_resource* resource) :
+        _uses { resource }, _edges { resource }, _readers { resource }, _loads { resource },
+        _numPredecessors { resource }, _successorOffsets { resource }, _successors { resource },
+        _heights { resource }, _ready { resource }, _deferred { resource }, _order { resource },
+        _scheduled { resource }
+    {}
+
+  public:
+    /// <summary>
+    /// Reorders the given basic block if it has fewer stalls in the new order. <c>loaded</c> is
+    /// the registers the instruction before the block loads, and <c>nextReads</c> is the registers
+    /// the instruction after the block reads.
+    /// </summary>
+    void Schedule(Fragment* begin, Fragment* end, uint32_t loaded, uint32_t nextReads)
+    {
+        auto numInstructions = static_cast<uint32_t>(end - begin);
+        _uses.clear();
+        for (auto it = begin; it != end; ++it) _uses.push_back(UseOf(it->data));
+
+        BuildGraph(numInstructions);
+        ListSchedule(numInstructions, loaded);
+
+        auto original  = [](uint32_t i) { return i; };
+        auto scheduled = [this](uint32_t i) { return _order[i]; };
+        if (CountStalls(numInstructions, scheduled, loaded, nextReads)
+            >= CountStalls(numInstructions, original, loaded, nextReads))
+            return;
+
+        _scheduled.clear();
+        for (auto index : _order) _scheduled.push_back(std::move(begin[index]));
+        std::move(_scheduled.begin(), _scheduled.end(), begin);
+    }
+
+  private:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    /// <summary>
+    /// Represents an instruction which reads a register, in the list of the readers of the
+    /// register since it is written.
+    /// </summary>
+    struct Reader
+    {
+        uint32_t instruction;
+        uint32_t next;
+    };
+
+    std::pmr::vector<RegisterUse>                   _uses;
+    std::pmr::vector<std::pair<uint32_t, uint32_t>> _edges;
+    std::pmr::vector<Reader>                        _readers;
+    std::pmr::vector<uint32_t>                      _loads; // the loads since the last store
+    std::pmr::vector<uint32_t>                      _numPredecessors;
+    std::pmr::vector<uint32_t>                      _successorOffsets;
+    std::pmr::vector<uint32_t>                      _successors;
+    std::pmr::vector<uint32_t>                      _heights;
+    std::pmr::vector<uint32_t>                      _ready;    // a heap by the priorities
+    std::pmr::vector<uint32_t>                      _deferred; // ready, but stalls
+    std::pmr::vector<uint32_t>                      _order;
+    std::pmr::vector<Fragment>                      _scheduled;
+
+  private:
+    void AddEdge(uint32_t from, uint32_t to)
+    {
+        if (from != None && from != to)
+            _edges.emplace_back(from, to);
+    }
+
+    void BuildGraph(uint32_t numInstructions)
+    {
+        std::array<uint32_t, 32> lastWriters, firstReaders;
+        lastWriters.fill(None);
+        firstReaders.fill(None);
+        uint32_t lastStore = None;
+
+        _edges.clear();
+        _readers.clear();
+        _loads.clear();
+        for (uint32_t i = 0; i < numInstructions; ++i)
+        {
+            auto use = _uses[i];
+            for (uint8_t reg = 1; reg < 32; ++reg)
+            {
+                auto mask = MaskOfRegister(reg);
+                if (use.reads & mask)
+                    AddEdge(lastWriters[reg], i);
+                if ((use.writes & mask) == 0)
+                    continue;
+
+                AddEdge(lastWriters[reg], i);
+                for (auto it = firstReaders[reg]; it != None; it = _readers[it].next)
+                    AddEdge(_readers[it].instruction, i);
+                lastWriters[reg]  = i;
+                firstReaders[reg] = None;
+            }
+            for (uint8_t reg = 1; reg < 32; ++reg)
+            {
+                if (use.reads & MaskOfRegister(reg))
+                {
+                    _readers.push_back({ i, firstReaders[reg] });
+                    firstReaders[reg] = static_cast<uint32_t>(_readers.size() - 1);
+                }
+            }
+
+            // loads may be reordered with each other, but not with stores
+            if (use.isLoad)
+            {
+                AddEdge(lastStore, i);
+                _loads.push_back(i);
+            }
+            else if (use.isStore)
+            {
+                AddEdge(lastStore, i);
+                for (auto load : _loads) AddEdge(load, i);
+                _loads.clear();
+                lastStore = i;
+            }
+        }
+
+        // the successors of each instruction are stored contiguously
+        _numPredecessors.assign(numInstructions, 0);
+        _successorOffsets.assign(numInstructions + 1, 0);
+        for (auto [from, to] : _edges)
+        {
+            ++_numPredecessors[to];
+            ++_successorOffsets[from + 1];
+        }
+        for (uint32_t i = 0; i < numInstructions; ++i)
+            _successorOffsets[i + 1] += _successorOffsets[i];
+
+        // the next positions of the successors are kept in _deferred, which is not used yet
+        _successors.resize(_edges.size());
+        _deferred.assign(_successorOffsets.begin(), _successorOffsets.end() - 1);
+        for (auto [from, to] : _edges) _successors[_deferred[from]++] = to;
+
+        // the height of an instruction is the length of the longest path from it, where a load
+        // takes a cycle more for the instructions using its result
+        _heights.assign(numInstructions, 1);
+        for (uint32_t i = numInstructions; i-- != 0;)
+        {
+            auto loaded = LoadedBy(_uses[i]);
+            for (auto j = _successorOffsets[i]; j != _successorOffsets[i + 1]; ++j)
+            {
+                auto successor = _successors[j];
+                auto latency   = (_uses[successor].reads & loaded) ? 2u : 1u;
+                _heights[i]    = std::max(_heights[i], _heights[successor] + latency);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Fills <c>_order</c> with the instructions in the scheduled order. The ready instruction
+    /// with the longest path is chosen first, and then the earliest one, but an instruction which
+    /// stalls is chosen only if every ready instruction does.
+    /// </summary>
+    void ListSchedule(uint32_t numInstructions, uint32_t loaded)
+    {
+        auto isLower = [this](uint32_t lhs, uint32_t rhs) {
+            if (_heights[lhs] != _heights[rhs])
+                return _heights[lhs] < _heights[rhs];
+            return lhs > rhs;
+        };
+
+        _ready.clear();
+        for (uint32_t i = 0; i < numInstructions; ++i)
+        {
+            if (_numPredecessors[i] == 0)
+                _ready.push_back(i);
+        }
+        std::make_heap(_ready.begin(), _ready.end(), isLower);
+
+        _order.clear();
+        while (!_ready.empty())
+        {
+            _deferred.clear();
+            uint32_t next = None;
+            while (!_ready.empty())
+            {
+                std::pop_heap(_ready.begin(), _ready.end(), isLower);
+                auto candidate = _ready.back();
+                _ready.pop_back();
+                if ((_uses[candidate].reads & loaded) == 0)
+                {
+                    next = candidate;
+                    break;
+                }
+                _deferred.push_back(candidate);
+            }
+
+            // the deferred instructions are in the order of their priorities
+            size_t numRestored = 0;
+            if (next == None)
+            {
+                next        = _deferred.front();
+                numRestored = 1;
+            }
+            for (auto it = _deferred.begin() + numRestored; it != _deferred.end(); ++it)
+            {
+                _ready.push_back(*it);
+                std::push_heap(_ready.begin(), _ready.end(), isLower);
+            }
+
+            _order.push_back(next);
+            loaded = LoadedBy(_uses[next]);
+            for (auto j = _successorOffsets[next]; j != _successorOffsets[next + 1]; ++j)
+            {
+                auto successor = _successors[j];
+                if (--_numPredecessors[successor] == 0)
+                {
+                    _ready.push_back(successor);
+                    std::push_heap(_ready.begin(), _ready.end(), isLower);
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Returns the number of the stalls of the block in the given order, including the first
+    /// instruction after the instruction before the block and the instruction after the block.
+    /// </summary>
+    template <typename IndexOf>
+    size_t CountStalls(uint32_t numInstructions,
+                       IndexOf  indexOf,
+                       uint32_t loaded,
+                       uint32_t nextReads) const noexcept
+    {
+        size_t numStalls = 0;
+        for (uint32_t i = 0; i < numInstructions; ++i)
+        {
+            auto use = _uses[indexOf(i)];
+            numStalls += (use.reads & loaded) != 0;
+            loaded = LoadedBy(use);
+        }
+        return numStalls + ((nextReads & loaded) != 0);
+    }
+};
+
+}
+
+DelaySlotReport FillDelaySlots(std::pmr::vector<Fragment>& fragments)
+{
+    // The fragments are compacted in place. The instruction before a branch is the last kept
+    // fragment, which may have been moved into the delay slot of the previous branch. The
+    // instructions in the data segment are data words, which are never moved.
+    DelaySlotReport report;
+    size_t          numKept         = 0;
+    bool            isInTextSegment = true;
+    for (size_t i = 0; i < fragments.size(); ++i)
+    {
+        auto const& data = fragments[i].data;
+        if (std::holds_alternative<DataDirData>(data) || std::holds_alternative<TextDirData>(data))
+            isInTextSegment = std::holds_alternative<TextDirData>(data);
+
+        if (!isInTextSegment || !IsControlTransfer(data) || i + 1 == fragments.size()
+            || !IsNop(fragments[i + 1].data))
+        {
+            fragments[numKept++] = std::move(fragments[i]);
+            continue;
+        }
+
+        bool canFill = false;
+        if (numKept != 0)
+        {
+            auto const& candidate = fragments[numKept - 1].data;
+            bool isIndependent    = IsIndependent(UseOf(candidate), UseOf(data));
+            canFill               = IsMovable(candidate) && !IsNop(candidate) && isIndependent;
+        }
+        if (canFill && numKept >= 2)
+        {
+            auto const& previous = fragments[numKept - 2].data;
+            canFill = !std::holds_alternative<LabelData>(previous) && !IsControlTransfer(previous);
+        }
+
+        if (!canFill)
+        {
+            // the nop is kept in the next iteration
+            ++report.numNopSlots;
+            fragments[numKept++] = std::move(fragments[i]);
+            continue;
+        }
+
+        // the transfer may be at numKept
+        ++report.numFilledSlots;
+        auto transfer          = std::move(fragments[i]);
+        fragments[numKept]     = std::move(fragments[numKept - 1]);
+        fragments[numKept - 1] = std::move(transfer);
+        ++numKept;
+        ++i; // skip the nop
+    }
+    fragments.erase(fragments.begin() + numKept, fragments.end());
+
+    return report;
+}
+
+size_t CountLoadUseStalls(std::pmr::vector<Fragment> const& fragments) noexcept
+{
+    size_t   numStalls       = 0;
+    uint32_t loaded          = 0;
+    bool     isInTextSegment = true;
+    for (auto const& fragment : fragments)
+    {
+        auto const& data = fragment.data;
+        if (std::holds_alternative<DataDirData>(data) || std::holds_alternative<TextDirData>(data))
+            isInTextSegment = std::holds_alternative<TextDirData>(data);
+        if (!isInTextSegment || std::holds_alternative<LabelData>(data))
+            continue;
+        if (!IsInstruction(data))
+        {
+            loaded = 0;
+            continue;
+        }
+
+        auto use = UseOf(data);
+        numStalls += (use.reads & loaded) != 0;
+        loaded = LoadedBy(use);
+    }
+    return numStalls;
+}
+
+LoadUseReport ScheduleLoads(std::pmr::vector<Fragment>& fragments, SchedulingOptions const& options)
+{
+    LoadUseReport report;
+    report.numStallsBefore = CountLoadUseStalls(fragments);
+
+    // the basic blocks are only in the text segment, and the data segment is skipped
+    BlockScheduler scheduler { fragments.get_allocator().resource() };
+    uint32_t       loaded          = 0; // the registers the last instruction loads
+    bool           isInDelaySlot   = false;
+    bool           isInTextSegment = true;
+    for (size_t i = 0; i < fragments.size();)
+    {
+        auto const& data = fragments[i].data;
+        if (std::holds_alternative<DataDirData>(data) || std::holds_alternative<TextDirData>(data))
+            isInTextSegment = std::holds_alternative<TextDirData>(data);
+
+        if (!isInTextSegment || !IsSchedulable(data) || isInDelaySlot)
+        {
+            if (!std::holds_alternative<LabelData>(data))
+            {
+                bool isInstruction = isInTextSegment && IsInstruction(data);
+                loaded             = isInstruction ? LoadedBy(UseOf(data)) : 0;
+                isInDelaySlot = isInstruction && options.hasDelaySlots && IsControlTransfer(data);
+            }
+            ++i;
+            continue;
+        }
+
+        size_t end = i + 1;
+        while (end < fragments.size() && IsSchedulable(fragments[end].data)) ++end;
+
+        // the instruction after the block, which may be after labels
+        uint32_t nextReads = 0;
+        for (size_t next = end; next < fragments.size(); ++next)
+        {
+            auto const& nextData = fragments[next].data;
+            if (std::holds_alternative<LabelData>(nextData))
+                continue;
+            if (IsInstruction(nextData))
+                nextReads = UseOf(nextData).reads;
+            break;
+        }
+
+        if (end - i >= 2)
+            scheduler.Schedule(fragments.data() + i, fragments.data() + end, loaded, nextReads);
+        loaded = LoadedBy(UseOf(fragments[end - 1].data));
+        i      = end;
+    }
+
+    report.numStallsAfter = CountLoadUseStalls(fragments);
+    return report;
+}
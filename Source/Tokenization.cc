@@ -1,208 +1,571 @@
 // Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
 // Licensed under the MIT License.
 
+#include <simple-mips-asm/Scanning.hh>
 #include <simple-mips-asm/Tokenization.hh>
 
+#include "ParallelFor.hh"
 #include <algorithm>
-#include <cctype>
-#include <variant>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 namespace
 {
 
-// ---------------------------------- Tokenizer output types ----------------------------------- //
-
-using StringIterator = std::string_view::const_iterator;
+// ------------------------------------- Character classes ------------------------------------- //
 
 /// <summary>
-/// Returned when the tokenizer cannot recognize the given string.
+/// Represents the class of the first byte of a token.
 /// </summary>
-struct CannotTokenize
-{};
+enum class CharClass : uint8_t
+{
+    Dot,          // .
+    Colon,        // :
+    Dollar,       // $
+    BracketOpen,  // (
+    BracketClose, // )
+    Comma,        // ,
+    NewLine,      // \n
+    Space,        // whitespaces except for \n
+    Zero,         // 0
+    Digit,        // [1-9]
+    Minus,        // -
+    LowerX,       // x
+    HexLetter,    // [a-fA-F]
+    Letter,       // [g-wyzG-Z]
+    Underscore,   // _
+    Hash,         // #
+    Invalid,      // any other byte
+};
+
+constexpr size_t NumCharClasses = static_cast<size_t>(CharClass::Invalid) + 1;
+
+constexpr CharClass ClassifyChar(unsigned char c) noexcept
+{
+    switch (c)
+    {
+    case '.': return CharClass::Dot;
+    case ':': return CharClass::Colon;
+    case '$': return CharClass::Dollar;
+    case '(': return CharClass::BracketOpen;
+    case ')': return CharClass::BracketClose;
+    case ',': return CharClass::Comma;
+    case '\n': return CharClass::NewLine;
+    case ' ':
+    case '\t':
+    case '\v':
+    case '\f':
+    case '\r': return CharClass::Space;
+    case '0': return CharClass::Zero;
+    case '-': return CharClass::Minus;
+    case 'x': return CharClass::LowerX;
+    case '_': return CharClass::Underscore;
+    case '#': return CharClass::Hash;
+    }
+
+    if ('1' <= c && c <= '9')
+        return CharClass::Digit;
+    if (('a' <= c && c <= 'f') || ('A' <= c && c <= 'F'))
+        return CharClass::HexLetter;
+    if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z'))
+        return CharClass::Letter;
+    return CharClass::Invalid;
+}
+
+constexpr std::array<CharClass, 256> MakeCharClassTable() noexcept
+{
+    std::array<CharClass, 256> table {};
+    for (size_t c = 0; c < table.size(); ++c)
+        table[c] = ClassifyChar(static_cast<unsigned char>(c));
+    return table;
+}
+
+constexpr std::array<CharClass, 256> _charClasses = MakeCharClassTable();
+
+// --------------------------------------- Token rules ----------------------------------------- //
 
 /// <summary>
-/// Returned when the tokenizer can recognize the given string, and the token has a valid format.
+/// Represents how a token extends after its first byte.
 /// </summary>
-struct CanTokenize
+enum class TokenShape : uint8_t
 {
-    StringIterator tokenEnd;
-    Token::Type    tokenType;
+    SingleCharacter,  // the token consists of its first byte only
+    Whitespaces,      // the token extends to the first byte which is not a whitespace
+    Complex,          // the token extends to the next delimiter
+    Comment,          // the byte starts a comment if comments are enabled
+    InvalidCharacter, // the byte cannot start any token
 };
 
 /// <summary>
-/// Returned when the tokenizer can recognize the given string, but the token has an invalid format.
+/// Describes the token which starts with a byte of a specific class. The body of a complex token,
+/// which starts <c>skip</c> bytes after the beginning of the token, is valid if every byte of it
+/// has its bit set in <c>allowed</c>.
 /// </summary>
-struct CanTokenizeButError : CanTokenize
+struct TokenRule
 {
-    TokenizationError::Type errorType;
+    TokenShape           shape;
+    Token::Type          type;
+    uint8_t              skip     = 0;
+    uint64_t BlockMasks::*allowed = nullptr;
+};
+
+constexpr TokenRule _hexIntegerRule {
+    TokenShape::Complex,
+    Token::Type::HexInteger,
+    2,
+    &BlockMasks::hexDigits,
 };
 
+constexpr TokenRule MakeTokenRule(CharClass c) noexcept
+{
+    switch (c)
+    {
+    case CharClass::Dot: return { TokenShape::SingleCharacter, Token::Type::Dot };
+    case CharClass::Colon: return { TokenShape::SingleCharacter, Token::Type::Colon };
+    case CharClass::Dollar: return { TokenShape::SingleCharacter, Token::Type::Dollar };
+    case CharClass::BracketOpen: return { TokenShape::SingleCharacter, Token::Type::BracketOpen };
+    case CharClass::BracketClose:
+        return { TokenShape::SingleCharacter, Token::Type::BracketClose };
+    case CharClass::Comma: return { TokenShape::SingleCharacter, Token::Type::Comma };
+    case CharClass::NewLine: return { TokenShape::SingleCharacter, Token::Type::NewLine };
+    case CharClass::Space: return { TokenShape::Whitespaces, Token::Type::Whitespace };
+    case CharClass::Zero:
+    case CharClass::Digit:
+    case CharClass::Minus:
+        return { TokenShape::Complex, Token::Type::Integer, 1, &BlockMasks::digits };
+    case CharClass::LowerX:
+    case CharClass::HexLetter:
+    case CharClass::Letter:
+    case CharClass::Underscore:
+        return { TokenShape::Complex, Token::Type::Word, 1, &BlockMasks::wordCharacters };
+    case CharClass::Hash: return { TokenShape::Comment, Token::Type::Whitespace };
+    default: return { TokenShape::InvalidCharacter, Token::Type::Whitespace };
+    }
+}
+
+constexpr std::array<TokenRule, NumCharClasses> MakeTokenRuleTable() noexcept
+{
+    std::array<TokenRule, NumCharClasses> table {};
+    for (size_t c = 0; c < NumCharClasses; ++c)
+        table[c] = MakeTokenRule(static_cast<CharClass>(c));
+    return table;
+}
+
+constexpr std::array<TokenRule, NumCharClasses> _tokenRules = MakeTokenRuleTable();
+
+// ------------------------------------- Structural index -------------------------------------- //
+
 /// <summary>
-/// Union of possible tokenizer output types
+/// Provides the structural bitmasks of the source code. Each block is classified once, when the
+/// lexer first reaches it. If comments are enabled, a number sign is also a delimiter.
 /// </summary>
-using TokenizerOutput = std::variant<CannotTokenize, CanTokenize, CanTokenizeButError>;
+class StructuralIndex
+{
+  public:
+    StructuralIndex(std::string_view code, bool skipComments) noexcept :
+        _code { code }, _scanner { GetBlockScanner() }, _skipComments { skipComments }
+    {}
+
+  public:
+    /// <summary>
+    /// Returns the offset of the first byte at or after <c>from</c> whose bit in the given mask
+    /// is equal to <c>value</c>, or the size of the code if there is no such byte.
+    /// </summary>
+    size_t FindNext(uint64_t BlockMasks::*mask, bool value, size_t from) noexcept
+    {
+        size_t const size = _code.size();
+        while (from < size)
+        {
+            size_t   blockIndex = from / BlockSize;
+            uint64_t bits       = Load(blockIndex).*mask;
+            if (!value)
+                bits = ~bits;
 
-// ---------------------------------------- Tokenizers ----------------------------------------- //
+            bits >>= from % BlockSize;
+            if (bits != 0)
+            {
+                size_t found = from + CountTrailingZeros(bits);
+                return found < size ? found : size;
+            }
+            from = (blockIndex + 1) * BlockSize;
+        }
+        return size;
+    }
+
+  private:
+    BlockMasks const& Load(size_t blockIndex) noexcept
+    {
+        if (blockIndex != _blockIndex)
+        {
+            size_t offset = blockIndex * BlockSize;
+            if (offset + BlockSize <= _code.size())
+                _masks = _scanner(_code.data() + offset);
+            else
+                _masks = ScanPartialBlock(_scanner, _code.substr(offset));
+            if (_skipComments)
+                _masks.delimiters |= _masks.hashes;
+            _blockIndex = blockIndex;
+        }
+        return _masks;
+    }
+
+  private:
+    std::string_view _code;
+    BlockScanner     _scanner;
+    bool             _skipComments;
+    size_t           _blockIndex = static_cast<size_t>(-1);
+    BlockMasks       _masks {};
+};
+
+// ------------------------------------------- Lexer ------------------------------------------- //
+
+inline CharClass ClassOf(char c) noexcept
+{
+    return _charClasses[static_cast<unsigned char>(c)];
+}
 
 /// <summary>
-/// Token pattern matcher
+/// Represents what the lexer recognized at a specific position.
 /// </summary>
-using Tokenizer = TokenizerOutput (*)(StringIterator, StringIterator);
+struct Lexeme
+{
+    enum class Kind
+    {
+        Token,            // a valid token
+        InvalidToken,     // a token with an invalid format
+        InvalidCharacter, // a character which cannot start any token
+    };
+
+    Kind        kind;
+    Token::Type type;
+    size_t      offset;
+    size_t      length;
+    Range       range;
+};
 
 /// <summary>
-/// Checks whether the given character is a whitespace character or can be a single character token.
+/// Recognizes tokens one by one from the beginning of the given code.
 /// </summary>
-bool IsDelimiter(char c)
-{
-    return isspace(c) || c == '.' || c == ':' || c == '$' || c == '(' || c == ')' || c == ','
-           || c == '\n';
-}
-
-template <Token::Type TokenTypeValue, char Character>
-TokenizerOutput SingleCharacterTokenizer(StringIterator begin, StringIterator end)
-{
-    if (*begin != Character)
-        return CannotTokenize {};
-    return CanTokenize { begin + 1, TokenTypeValue };
-}
-
-#define DEFINE_COMPLEX_TOKENIZER(InitialCondition, Verification, Skip, TokenType)                  \
-    TokenizerOutput TokenType##Tokenizer(StringIterator begin, StringIterator end)                 \
-    {                                                                                              \
-        if (InitialCondition)                                                                      \
-        {                                                                                          \
-            auto tokenEnd = std::find_if(begin + (Skip), end, IsDelimiter);                        \
-            auto invalidCharIt                                                                     \
-                = std::find_if_not(begin + (Skip), end, [](char c) { return (Verification); });    \
-            if (invalidCharIt != tokenEnd)                                                         \
-            {                                                                                      \
-                return CanTokenizeButError {                                                       \
-                    tokenEnd,                                                                      \
-                    Token::Type::TokenType,                                                        \
-                    TokenizationError::Type::InvalidFormat,                                        \
-                };                                                                                 \
-            }                                                                                      \
-            return CanTokenize { tokenEnd, Token::Type::TokenType };                               \
-        }                                                                                          \
-        return CannotTokenize {};                                                                  \
+class Lexer
+{
+  public:
+    Lexer(std::string_view code, TokenizationOptions const& options, uint32_t line = 1) noexcept :
+        _code { code }, _index { code, options.skipComments }, _options { options }, _line { line }
+    {}
+
+  public:
+    /// <summary>
+    /// Recognizes the next lexeme. Returns false if there are no bytes left.
+    /// </summary>
+    bool Next(Lexeme& lexeme) noexcept
+    {
+        while (_offset < _code.size())
+        {
+            if (NextOrSkip(lexeme))
+                return true;
+        }
+        return false;
     }
 
-DEFINE_COMPLEX_TOKENIZER((std::distance(begin, end) >= 2 && begin[0] == '0' && begin[1] == 'x'),
-                         (isdigit(c) || ('A' <= toupper(c) && toupper(c) <= 'F')),
-                         2,
-                         HexInteger);
+  private:
+    /// <summary>
+    /// Recognizes the lexeme at the current offset. Returns false if the lexeme is a comment or
+    /// an elided token.
+    /// </summary>
+    bool NextOrSkip(Lexeme& lexeme) noexcept
+    {
+        char const* const data = _code.data();
+        size_t const      size = _code.size();
+
+        size_t const     tokenBegin = _offset;
+        TokenRule const* rule       = &_tokenRules[static_cast<size_t>(ClassOf(data[_offset]))];
+
+        Position begin { _line, static_cast<uint32_t>(tokenBegin - _lineBegin + 1) };
+        bool     isValid = true;
+        switch (rule->shape)
+        {
+        case TokenShape::SingleCharacter: _offset += 1; break;
+        case TokenShape::Whitespaces:
+            _offset = _index.FindNext(&BlockMasks::whitespaces, false, _offset + 1);
+            if (_options.elideWhitespaces)
+                return false;
+            break;
+        case TokenShape::Complex:
+            if (data[_offset] == '0' && _offset + 1 < size && data[_offset + 1] == 'x')
+                rule = &_hexIntegerRule;
+            _offset = _index.FindNext(&BlockMasks::delimiters, true, _offset + 1);
+            if (tokenBegin + rule->skip < _offset)
+                isValid = _index.FindNext(rule->allowed, false, tokenBegin + rule->skip) >= _offset;
+            break;
+        case TokenShape::Comment:
+            if (_options.skipComments)
+            {
+                auto newLine = static_cast<char const*>(
+                    std::memchr(data + _offset, '\n', size - _offset));
+                _offset = newLine ? newLine - data : size;
+                return false;
+            }
+            [[fallthrough]];
+        case TokenShape::InvalidCharacter:
+            _offset += 1;
+            lexeme = {
+                Lexeme::Kind::InvalidCharacter,
+                rule->type,
+                tokenBegin,
+                1,
+                { begin, begin.MoveRight() },
+            };
+            return true;
+        }
 
-DEFINE_COMPLEX_TOKENIZER((isdigit(*begin) || *begin == '-'), isdigit(c), 1, Integer);
+        Position end { _line, static_cast<uint32_t>(_offset - _lineBegin + 1) };
+        if (rule->type == Token::Type::NewLine)
+        {
+            end        = begin.NextLine();
+            _line      = end.line;
+            _lineBegin = _offset;
+        }
 
-DEFINE_COMPLEX_TOKENIZER((isalpha(*begin) || *begin == '_'),
-                         (isalpha(c) || isdigit(c) || c == '_'),
-                         1,
-                         Word);
+        lexeme = {
+            isValid ? Lexeme::Kind::Token : Lexeme::Kind::InvalidToken,
+            rule->type,
+            tokenBegin,
+            _offset - tokenBegin,
+            { begin, end },
+        };
+        return true;
+    }
 
-TokenizerOutput WhitespaceTokenizer(StringIterator begin, StringIterator end)
+  private:
+    std::string_view    _code;
+    StructuralIndex     _index;
+    TokenizationOptions _options;
+    size_t              _offset    = 0;
+    size_t              _lineBegin = 0;
+    uint32_t            _line;
+};
+
+// ---------------------------------------- Utilities ------------------------------------------ //
+
+/// <summary>
+/// The minimum number of bytes a thread of <c>TokenizeParallel</c> takes at once, unless given.
+/// </summary>
+constexpr size_t MinChunkSize = 1 << 16;
+
+/// <summary>
+/// Splits the given code into chunks of approximately the given size, each of which ends right
+/// after a new line character or at the end of the code.
+/// </summary>
+std::vector<std::string_view> SplitIntoChunks(std::string_view code, size_t chunkSize)
 {
-    if (isspace(*begin) && *begin != '\n')
+    std::vector<std::string_view> chunks;
+
+    size_t offset = 0;
+    while (offset < code.size())
     {
-        auto tokenEnd
-            = std::find_if_not(begin, end, [](char c) { return isspace(c) && c != '\n'; });
+        size_t end = code.size();
+        if (chunkSize < code.size() - offset)
+        {
+            auto from    = code.data() + offset + chunkSize - 1;
+            auto newLine = static_cast<char const*>(
+                std::memchr(from, '\n', code.data() + code.size() - from));
+            if (newLine)
+                end = newLine - code.data() + 1;
+        }
 
-        return CanTokenize { tokenEnd, Token::Type::Whitespace };
+        chunks.push_back(code.substr(offset, end - offset));
+        offset = end;
     }
-    return CannotTokenize {};
-}
-
-Tokenizer _tokenizers[] = {
-    SingleCharacterTokenizer<Token::Type::Dot, '.'>,
-    SingleCharacterTokenizer<Token::Type::Colon, ':'>,
-    SingleCharacterTokenizer<Token::Type::Dollar, '$'>,
-    SingleCharacterTokenizer<Token::Type::BracketOpen, '('>,
-    SingleCharacterTokenizer<Token::Type::BracketClose, ')'>,
-    SingleCharacterTokenizer<Token::Type::Comma, ','>,
-    SingleCharacterTokenizer<Token::Type::NewLine, '\n'>,
-    HexIntegerTokenizer,
-    IntegerTokenizer,
-    WordTokenizer,
-    WhitespaceTokenizer,
-};
 
-// ----------------------------------------  Utilities ----------------------------------------- //
+    return chunks;
+}
 
-Token MakeToken(Token::Type type, StringIterator begin, StringIterator end, Position& position)
+/// <summary>
+/// Appends the given lexeme to the given arrays of tokens and errors.
+/// </summary>
+template <typename TokenArray, typename ErrorArray>
+void AppendLexeme(std::string_view code,
+                  Lexeme const&    lexeme,
+                  TokenArray&      tokens,
+                  ErrorArray&      errors)
 {
-    Position beginPos = position, endPos = position;
-    for (auto it = begin; it != end; ++it)
+    if (lexeme.kind == Lexeme::Kind::InvalidCharacter)
     {
-        if (*it == '\n')
-            endPos = endPos.NextLine();
-        else
-            endPos = endPos.MoveRight();
+        errors.push_back({ TokenizationError::Type::InvalidCharacter, lexeme.range });
+        return;
     }
-    position = endPos;
 
-    return Token {
-        type,
-        { beginPos, endPos },
-        std::string_view(std::addressof(*begin), std::distance(begin, end)),
-    };
+    tokens.push_back({
+        lexeme.type,
+        lexeme.range,
+        code.substr(lexeme.offset, lexeme.length),
+    });
+    if (lexeme.kind == Lexeme::Kind::InvalidToken)
+        errors.push_back({ TokenizationError::Type::InvalidFormat, lexeme.range });
+}
+
+/// <summary>
+/// Moves the given range to the given number of lines below.
+/// </summary>
+inline Range MoveDown(Range range, uint32_t numLines) noexcept
+{
+    range.begin.line += numLines;
+    range.end.line += numLines;
+    return range;
 }
 
 }
 
-TokenizationResult Tokenize(std::string_view code)
+TokenizationResult Tokenize(std::string_view           code,
+                            TokenizationOptions const& options,
+                            std::pmr::memory_resource* resource)
 {
-    auto       begin = code.begin();
-    auto const end   = code.end();
+    std::pmr::vector<Token>             tokens { resource };
+    std::pmr::vector<TokenizationError> errors { resource };
 
-    Position position;
+    Lexer  lexer { code, options };
+    Lexeme lexeme;
+    while (lexer.Next(lexeme))
+        AppendLexeme(code, lexeme, tokens, errors);
 
-    std::vector<Token>             tokens;
+    return { std::move(tokens), std::move(errors) };
+}
+
+struct TokenStream::Impl
+{
+    std::string_view               code;
+    Lexer                          lexer;
     std::vector<TokenizationError> errors;
+};
+
+TokenStream::TokenStream(std::string_view code, TokenizationOptions const& options) :
+    _impl { new Impl { code, Lexer { code, options }, {} } }
+{}
+
+TokenStream::TokenStream(TokenStream&&) noexcept = default;
+
+TokenStream& TokenStream::operator=(TokenStream&&) noexcept = default;
 
-    while (begin != end)
+TokenStream::~TokenStream() = default;
+
+bool TokenStream::NextLine(std::vector<Token>& line)
+{
+    line.clear();
+
+    Lexeme lexeme;
+    while (_impl->lexer.Next(lexeme))
     {
-        bool tokenized = false;
-        for (auto tokenizer : _tokenizers)
-        {
-            auto result = tokenizer(begin, end);
+        AppendLexeme(_impl->code, lexeme, line, _impl->errors);
+        if (lexeme.type == Token::Type::NewLine && lexeme.kind != Lexeme::Kind::InvalidCharacter)
+            break;
+    }
 
-            if (std::holds_alternative<CanTokenize>(result))
-            {
-                auto const& output = std::get<CanTokenize>(result);
-                tokenized          = true;
-                tokens.push_back(MakeToken(output.tokenType, begin, output.tokenEnd, position));
-                begin = output.tokenEnd;
-                break;
-            }
-            else if (std::holds_alternative<CanTokenizeButError>(result))
-            {
-                auto const& output = std::get<CanTokenizeButError>(result);
-                tokenized          = true;
-                auto token         = MakeToken(output.tokenType, begin, output.tokenEnd, position);
-                tokens.push_back(token);
-                errors.push_back({
-                    output.errorType,
-                    token.range,
-                });
-                begin = output.tokenEnd;
-                break;
-            }
-        }
+    return !line.empty();
+}
 
-        if (!tokenized)
-        {
-            auto newPosition = position.MoveRight();
-            if (*begin == '\n')
-                newPosition = position.NextLine();
+std::vector<TokenizationError> const& TokenStream::GetErrors() const noexcept
+{
+    return _impl->errors;
+}
+
+TokenizationResult TokenizeParallel(std::string_view           code,
+                                    TokenizationOptions const& options,
+                                    ParallelOptions const&     parallelOptions)
+{
+    size_t numThreads = GetNumThreads(parallelOptions);
+    if (numThreads <= 1)
+        return Tokenize(code, options);
+
+    size_t chunkSize = parallelOptions.chunkSize;
+    if (chunkSize == 0)
+        chunkSize = std::max(code.size() / (numThreads * 4), MinChunkSize);
+
+    auto chunks = SplitIntoChunks(code, chunkSize);
+    if (chunks.size() <= 1)
+        return Tokenize(code, options);
+
+    // Every chunk starts at the beginning of a line, so each chunk is tokenized exactly as in the
+    // serial version, except that its line numbers start from 1.
+    std::vector<TokenizationResult> results(chunks.size());
+    std::vector<uint32_t>           numLines(chunks.size());
+    ParallelFor(chunks.size(), numThreads, [&](size_t i) {
+        results[i]  = Tokenize(chunks[i], options);
+        numLines[i] = static_cast<uint32_t>(CountNewLines(chunks[i]));
+    });
+
+    std::vector<uint32_t> lineOffsets(chunks.size());
+    std::vector<size_t>   tokenOffsets(chunks.size());
+    size_t                numTokens = 0;
+    size_t                numErrors = 0;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        lineOffsets[i]  = i == 0 ? 0 : lineOffsets[i - 1] + numLines[i - 1];
+        tokenOffsets[i] = numTokens;
+        numTokens += results[i].tokens.size();
+        numErrors += results[i].errors.size();
+    }
+
+    std::pmr::vector<Token>             tokens(numTokens);
+    std::pmr::vector<TokenizationError> errors;
+    errors.reserve(numErrors);
+
+    ParallelFor(chunks.size(), numThreads, [&](size_t i) {
+        auto output = tokens.begin() + tokenOffsets[i];
+        for (auto const& token : results[i].tokens)
+            *output++ = { token.type, MoveDown(token.range, lineOffsets[i]), token.value };
+        results[i].tokens = {};
+    });
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        for (auto const& error : results[i].errors)
+            errors.push_back({ error.type, MoveDown(error.range, lineOffsets[i]) });
+    }
+
+    return { std::move(tokens), std::move(errors) };
+}
 
-            errors.push_back({
-                TokenizationError::Type::InvalidCharacter,
-                { position, newPosition },
-            });
+CompactTokenizationResult TokenizeCompact(std::string_view code, TokenizationOptions const& options)
+{
+    TokenBuffer                    tokens { code, {}, {}, {}, {} };
+    std::vector<TokenizationError> errors;
 
-            position = newPosition;
-            ++begin;
+    tokens.lineBegins.push_back(0);
+
+    Lexer  lexer { code, options };
+    Lexeme lexeme;
+    while (lexer.Next(lexeme))
+    {
+        if (lexeme.kind == Lexeme::Kind::InvalidCharacter)
+        {
+            errors.push_back({ TokenizationError::Type::InvalidCharacter, lexeme.range });
+            continue;
         }
+
+        tokens.types.push_back(lexeme.type);
+        tokens.offsets.push_back(static_cast<uint32_t>(lexeme.offset));
+        tokens.lengths.push_back(static_cast<uint32_t>(lexeme.length));
+        if (lexeme.type == Token::Type::NewLine)
+            tokens.lineBegins.push_back(static_cast<uint32_t>(lexeme.offset + 1));
+        if (lexeme.kind == Lexeme::Kind::InvalidToken)
+            errors.push_back({ TokenizationError::Type::InvalidFormat, lexeme.range });
     }
 
     return { std::move(tokens), std::move(errors) };
 }
+
+Position TokenBuffer::GetPosition(uint32_t offset) const noexcept
+{
+    auto it = std::upper_bound(lineBegins.begin(), lineBegins.end(), offset);
+    auto line = static_cast<uint32_t>(std::distance(lineBegins.begin(), it));
+    return Position { line, offset - it[-1] + 1 };
+}
+
+Range TokenBuffer::GetRange(size_t index) const noexcept
+{
+    Position begin = GetPosition(offsets[index]);
+    if (types[index] == Token::Type::NewLine)
+        return Range { begin, begin.NextLine() };
+    return Range { begin, { begin.line, begin.character + lengths[index] } };
+}
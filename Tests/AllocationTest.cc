@@ -0,0 +1,237 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <gtest/gtest.h>
+#include <simple-mips-asm/Arena.hh>
+#include <simple-mips-asm/Assembler.hh>
+#include <simple-mips-asm/Generation.hh>
+#include <simple-mips-asm/Parsing.hh>
+#include <simple-mips-asm/Tokenization.hh>
+
+#include "TestCommon.hh"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// -----------------------------------  Allocation counter ------------------------------------- //
+
+namespace
+{
+
+std::atomic<size_t> _numAllocations { 0 };
+
+void* Allocate(size_t size, size_t alignment)
+{
+    _numAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    // aligned_alloc requires the size to be a multiple of the alignment
+    size = (size + alignment - 1) / alignment * alignment;
+    if (void* pointer = std::aligned_alloc(alignment, size == 0 ? alignment : size))
+        return pointer;
+    throw std::bad_alloc {};
+}
+
+}
+
+void* operator new(size_t size)
+{
+    return Allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+namespace
+{
+
+template <typename Function>
+size_t CountAllocations(Function&& function)
+{
+    size_t before = _numAllocations.load(std::memory_order_relaxed);
+    function();
+    return _numAllocations.load(std::memory_order_relaxed) - before;
+}
+
+// ------------------------------------------  Codes ------------------------------------------- //
+
+std::string MakeValidCode(size_t numRepeats)
+{
+    std::string code = "        .data\narray:  .word 3\n        .word 0x12345678\n        .text\n";
+    for (size_t i = 0; i < numRepeats; ++i)
+    {
+        auto label = "loop" + std::to_string(i);
+        code += label + ":\n";
+        code += "        la      $4, array\n";
+        code += "        lw      $9, 4($4)\n";
+        code += "        addiu   $2, $2, -1\n";
+        code += "        bne     $2, $0, " + label + "\n";
+        code += "        jal     " + label + "\n";
+    }
+    return code;
+}
+
+// every line here goes through the tokenizer fallback of ParseCode
+char const _invalidCode[] = R"==(
+        addu $1, $2
+        foo bar
+        .word -1
+        lw $1, 70000($2)
+        sll $1, $2, 32 # comment
+        j
+)==";
+
+struct Outputs
+{
+    GenerationResult generated;
+    GenerationResult encoded;
+    ParseResult      invalid;
+    CodeParseResult  invalidCode;
+};
+
+Outputs Assemble(std::string_view code, std::pmr::memory_resource* resource)
+{
+    auto tokenizationResult = Tokenize(code, {}, resource);
+    auto parsingResult      = Parse(tokenizationResult.tokens, {}, resource);
+    auto generated          = GenerateCode(parsingResult.fragments, {}, resource);
+
+    auto encodingResult = EncodeCode(code, {}, {}, resource);
+    auto encoded        = GenerateCode(std::move(encodingResult.code));
+
+    auto invalid     = Parse(Tokenize(_invalidCode, {}, resource).tokens, {}, resource);
+    auto invalidCode = ParseCode(_invalidCode, { false, true }, {}, resource);
+
+    return { std::move(generated), std::move(encoded), std::move(invalid), std::move(invalidCode) };
+}
+
+}
+
+// ------------------------------------------  Tests ------------------------------------------- //
+
+TEST(AllocationTest, SteadyState)
+{
+    auto code     = MakeValidCode(1000);
+    auto expected = Assemble(code, std::pmr::get_default_resource());
+    ASSERT_TRUE(std::holds_alternative<CanGenerate>(expected.generated));
+
+    // the arena starts small, so it has to grow during the first file
+    Arena arena { 256 };
+    for (int i = 0; i < 3; ++i)
+    {
+        // assigning to an existing result would copy into its resource, so construct it in place
+        std::optional<Outputs> outputs;
+        size_t numAllocations = CountAllocations([&] { outputs.emplace(Assemble(code, &arena)); });
+        if (i == 0)
+            EXPECT_NE(numAllocations, 0);
+        else
+            EXPECT_EQ(numAllocations, 0);
+
+        ExpectSameResult(outputs->generated, expected.generated);
+        ExpectSameResult(outputs->encoded, expected.generated);
+        EXPECT_EQ(outputs->invalid.errors.size(), 6);
+        EXPECT_EQ(outputs->invalidCode.parseResult.errors.size(), 6);
+
+        // the outputs must be destroyed before the memory is reused
+        outputs.reset();
+        arena.Reset();
+    }
+}
+
+TEST(AllocationTest, StdVectorOverloads)
+{
+    auto code     = MakeValidCode(100);
+    auto expected = Assemble(code, std::pmr::get_default_resource());
+    ASSERT_TRUE(std::holds_alternative<CanGenerate>(expected.generated));
+
+    auto tokenizationResult = Tokenize(code);
+    auto parsingResult      = Parse(tokenizationResult.tokens);
+
+    // the overloads for std::vector are the same as the ones for std::pmr::vector
+    auto const&        pmrTokens = tokenizationResult.tokens;
+    std::vector<Token> tokens { pmrTokens.begin(), pmrTokens.end() };
+    auto               fromTokens = Parse(tokens);
+    ASSERT_EQ(fromTokens.fragments.size(), parsingResult.fragments.size());
+
+    auto const&           fragments = fromTokens.fragments;
+    std::vector<Fragment> copied { fragments.begin(), fragments.end() };
+    ExpectSameResult(GenerateCode(copied), expected.generated);
+}
+
+TEST(AllocationTest, Assembler)
+{
+    auto code = MakeValidCode(1000);
+
+    Assembler assembler { {}, {}, {}, 256 };
+    assembler.Assemble(code);
+    assembler.Assemble(_invalidCode);
+
+    // a warm assembler does not allocate for the same or smaller inputs
+    size_t numAllocations = CountAllocations([&] {
+        assembler.Assemble(_invalidCode);
+        assembler.Assemble(code);
+        assembler.Assemble(std::string_view { code }.substr(0, code.size() / 2));
+    });
+    EXPECT_EQ(numAllocations, 0);
+}
+
+TEST(AllocationTest, Arena)
+{
+    Arena arena { 64 };
+    EXPECT_EQ(arena.GetCapacity(), 64);
+
+    // allocations keep their alignment and do not overlap
+    std::pmr::vector<void*> pointers(&arena);
+    pointers.reserve(100);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        size_t alignment = size_t(1) << (i % 7);
+        void*  pointer   = arena.allocate(i + 1, alignment);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(pointer) % alignment, 0);
+        std::memset(pointer, static_cast<int>(i), i + 1);
+        pointers.push_back(pointer);
+    }
+    for (size_t i = 0; i < 100; ++i)
+    {
+        auto bytes = static_cast<unsigned char const*>(pointers[i]);
+        for (size_t j = 0; j <= i; ++j) ASSERT_EQ(bytes[j], static_cast<unsigned char>(i));
+    }
+
+    // the additional blocks are merged, so the same allocations fit in the main block
+    size_t capacity = arena.GetCapacity();
+    EXPECT_LT(64, capacity);
+    arena.Reset();
+    EXPECT_EQ(arena.GetCapacity(), capacity);
+
+    size_t numAllocations = CountAllocations([&] {
+        for (size_t i = 0; i < 100; ++i) (void)arena.allocate(i + 1, size_t(1) << (i % 7));
+    });
+    EXPECT_EQ(numAllocations, 0);
+    EXPECT_EQ(arena.GetCapacity(), capacity);
+}
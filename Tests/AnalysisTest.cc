@@ -0,0 +1,112 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <gtest/gtest.h>
+#include <simple-mips-asm/Analysis.hh>
+#include <simple-mips-asm/Parsing.hh>
+
+#include "TestCommon.hh"
+#include <tuple>
+#include <utility>
+#include <vector>
+
+TEST(AnalysisTest, Blocks)
+{
+    auto parseResult = ParseCode("main: lw $2, 0($4)\n"
+                                 "addu $3, $2, $0\n"
+                                 "la $5, main\n"
+                                 "loop: addiu $6, $6, 1\n"
+                                 "lw $7, 0($5)\n"
+                                 "bne $6, $7, loop\n"
+                                 "jal f\n"
+                                 "f: jr $31\n"
+                                 ".data\n"
+                                 "d: .word 1\n")
+                           .parseResult;
+    ASSERT_TRUE(parseResult.errors.empty());
+
+    auto report = EstimateCycles(parseResult.fragments);
+    EXPECT_EQ(report.totalCycles, 14);
+
+    // the first line, the instructions, the stalls, the penalty, the loop depth, and the cycles
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint64_t>> const
+        expectedBlocks = {
+            { 4, 3, 1, 1, 1, 50 },
+            { 1, 4, 1, 0, 0, 5 },
+            { 7, 1, 0, 1, 0, 2 },
+            { 8, 1, 0, 1, 0, 2 },
+        };
+    auto const& blocks = report.blocks;
+    ASSERT_EQ_VECTOR(blocks, expectedBlocks, lit->range.begin.line, std::get<0>(*rit));
+    ASSERT_EQ_VECTOR(blocks, expectedBlocks, lit->numInstructions, std::get<1>(*rit));
+    ASSERT_EQ_VECTOR(blocks, expectedBlocks, lit->numStallCycles, std::get<2>(*rit));
+    ASSERT_EQ_VECTOR(blocks, expectedBlocks, lit->numPenaltyCycles, std::get<3>(*rit));
+    ASSERT_EQ_VECTOR(blocks, expectedBlocks, lit->loopDepth, std::get<4>(*rit));
+    ASSERT_EQ_VECTOR(blocks, expectedBlocks, lit->weightedCycles, std::get<5>(*rit));
+    EXPECT_EQ(blocks[2].label, std::nullopt);
+
+    // the code of loop is also the block after the branch
+    std::vector<std::tuple<char const*, uint64_t, uint64_t>> const expectedLabels = {
+        { "loop", 7, 52 },
+        { "main", 5, 5 },
+        { "f", 2, 2 },
+    };
+    auto const& labels = report.labels;
+    ASSERT_EQ_VECTOR(labels,
+                     expectedLabels,
+                     parseResult.symbols.GetName(lit->symbol),
+                     std::get<0>(*rit));
+    ASSERT_EQ_VECTOR(labels, expectedLabels, lit->cycles, std::get<1>(*rit));
+    ASSERT_EQ_VECTOR(labels, expectedLabels, lit->weightedCycles, std::get<2>(*rit));
+}
+
+TEST(AnalysisTest, DelaySlots)
+{
+    auto parseResult = ParseCode("loop: addiu $6, $6, 1\n"
+                                 "bne $6, $7, loop\n"
+                                 "sll $0, $0, 0\n"
+                                 "jr $31\n"
+                                 "sll $0, $0, 0\n")
+                           .parseResult;
+    ASSERT_TRUE(parseResult.errors.empty());
+
+    // the delay slots are in the blocks of the branches, and the penalty is in the slots
+    PipelineModel model;
+    model.hasDelaySlots = true;
+
+    auto report = EstimateCycles(parseResult.fragments, model);
+    EXPECT_EQ(report.totalCycles, 5);
+    ASSERT_EQ(report.blocks.size(), 2);
+    EXPECT_EQ(report.blocks[0].cycles, 3);
+    EXPECT_EQ(report.blocks[0].weightedCycles, 30);
+    EXPECT_EQ(report.blocks[1].cycles, 2);
+
+    report = EstimateCycles(parseResult.fragments);
+    EXPECT_EQ(report.totalCycles, 7);
+    ASSERT_EQ(report.blocks.size(), 3);
+    EXPECT_EQ(report.blocks[0].weightedCycles, 30);
+}
+
+TEST(AnalysisTest, Loops)
+{
+    auto parseResult = ParseCode("outer: addiu $1, $1, 1\n"
+                                 "inner: addiu $2, $2, 1\n"
+                                 "bne $2, $3, inner\n"
+                                 "beq $2, $4, inner\n"
+                                 "bne $1, $3, outer\n"
+                                 "jr $31\n")
+                           .parseResult;
+    ASSERT_TRUE(parseResult.errors.empty());
+
+    // the branches back to inner make a single loop in the loop of outer
+    auto report = EstimateCycles(parseResult.fragments);
+    std::vector<std::pair<uint32_t, uint32_t>> const expected = {
+        { 2, 2 },
+        { 4, 2 },
+        { 5, 1 },
+        { 1, 1 },
+        { 6, 0 },
+    };
+    ASSERT_EQ_VECTOR(report.blocks, expected, lit->range.begin.line, rit->first);
+    ASSERT_EQ_VECTOR(report.blocks, expected, lit->loopDepth, rit->second);
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <gtest/gtest.h>
+#include <simple-mips-asm/Assembler.hh>
+#include <simple-mips-asm/Generation.hh>
+#include <simple-mips-asm/Parsing.hh>
+
+#include "TestCommon.hh"
+#include <string>
+#include <vector>
+
+// ------------------------------------------  Codes ------------------------------------------- //
+
+char const _validCode[] = R"==(
+        .data
+var:    .word   5
+        .text
+main:   la      $8, var
+        lw      $9, 0($8)
+        jal     sum
+        j       exit
+sum:    sltiu   $1, $2, 1
+        bne     $1, $0, exit
+        addiu   $2, $2, -1
+        j       sum
+exit:   jr      $31
+)==";
+
+/// <summary>
+/// Checks whether the given result of the assembler is the same as generating code from the
+/// fragments of the given code.
+/// </summary>
+void ExpectSameAsFragments(AssemblyResult const& result, std::string const& code)
+{
+    ASSERT_TRUE(result.tokenizationErrors.empty());
+    ASSERT_TRUE(result.parsingErrors.empty());
+    ASSERT_TRUE(result.generationResult.has_value());
+    ASSERT_TRUE(std::holds_alternative<CanGenerate>(*result.generationResult));
+
+    auto parseResult = ParseCode(code).parseResult;
+    ExpectSameResult(*result.generationResult, GenerateCode(parseResult.fragments), code);
+}
+
+// ------------------------------------------  Tests ------------------------------------------- //
+
+TEST(AssemblerTest, ValidCode)
+{
+    Assembler assembler;
+
+    // the assembler keeps its own copy of the code
+    {
+        std::string code = _validCode;
+        assembler.Assemble(code);
+    }
+    EXPECT_EQ(assembler.GetSource(), _validCode);
+
+    // a smaller code reuses the buffers of the previous one
+    std::string smallCode = ".text\nloop: j loop\n";
+    for (int i = 0; i < 3; ++i)
+    {
+        std::string const& code   = i % 2 == 0 ? smallCode : std::string { _validCode };
+        auto const&        result = assembler.Assemble(code);
+        ExpectSameAsFragments(result, code);
+        ASSERT_TRUE(result.symbols.size() != 0);
+        EXPECT_EQ(result.symbols.GetName(0), i % 2 == 0 ? "loop" : "var");
+    }
+}
+
+TEST(AssemblerTest, Errors)
+{
+    Assembler assembler;
+
+    // code is not generated if it cannot be parsed
+    auto const& parsingResult = assembler.Assemble("addu $1, $2\n.text\n");
+    ASSERT_EQ(parsingResult.parsingErrors.size(), 1);
+    EXPECT_EQ(parsingResult.parsingErrors[0].type, ParsingError::Type::UnexpectedToken);
+    EXPECT_FALSE(parsingResult.generationResult.has_value());
+
+    auto const& generationResult = assembler.Assemble(".text\nmain: j nowhere\n");
+    EXPECT_TRUE(generationResult.parsingErrors.empty());
+    ASSERT_TRUE(generationResult.generationResult.has_value());
+    ASSERT_TRUE(std::holds_alternative<CannotGenerate>(*generationResult.generationResult));
+
+    std::vector<std::pair<GenerationError::Type, uint32_t>> expected {
+        { GenerationError::Type::UndefinedLabelName, 2 },
+    };
+
+    auto const& errors = std::get<CannotGenerate>(*generationResult.generationResult).errors;
+    ASSERT_EQ_VECTOR(errors, expected, lit->type, rit->first);
+    ASSERT_EQ_VECTOR(errors, expected, lit->range.begin.line, rit->second);
+
+    // the assembler recovers from the errors
+    std::string code = _validCode;
+    ExpectSameAsFragments(assembler.Assemble(code), code);
+}
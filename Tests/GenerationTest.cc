@@ -7,6 +7,9 @@
 #include <simple-mips-asm/Tokenization.hh>
 
 #include "TestCommon.hh"
+#include <random>
+#include <string>
+#include <vector>
 
 // ------------------------------------------  Codes ------------------------------------------- //
 
@@ -62,6 +65,74 @@ sum_exit:
     jr $31
 exit:)==";
 
+// -----------------------------------------  Helpers ------------------------------------------ //
+
+/// <summary>
+/// Returns the given line repeated the given number of times.
+/// </summary>
+std::string Repeat(char const* line, int count)
+{
+    std::string lines;
+    for (int i = 0; i < count; ++i) lines += line;
+    return lines;
+}
+
+/// <summary>
+/// Generates code from the fragments of the given code, and checks whether the text segment has
+/// the given size and the given pairs of indices and words. The encoded code must give the same
+/// result.
+/// </summary>
+void ExpectWords(std::string const&                              code,
+                 GenerationOptions const&                        options,
+                 std::vector<std::pair<size_t, uint32_t>> const& expected,
+                 size_t                                          size)
+{
+    auto parsingResult    = ParseCode(code).parseResult;
+    auto generationResult = GenerateCode(parsingResult.fragments, options);
+    ASSERT_TRUE(std::holds_alternative<CanGenerate>(generationResult));
+
+    auto const& text = std::get<CanGenerate>(generationResult).text;
+    ASSERT_EQ(text.size(), size);
+    for (auto [index, word] : expected) EXPECT_EQ(text[index], word) << index;
+
+    ExpectSameResult(GenerateCode(EncodeCode(code).code, options), generationResult);
+}
+
+/// <summary>
+/// Checks whether generating code from the fragments of the given code and generating code from
+/// the encoded code give the same result.
+/// </summary>
+void ExpectSameAsFragments(std::string const& code)
+{
+    auto parseResult = ParseCode(code).parseResult;
+    ASSERT_TRUE(parseResult.errors.empty()) << code;
+    auto expected = GenerateCode(parseResult.fragments);
+
+    auto encodingResult = EncodeCode(code);
+    ASSERT_TRUE(encodingResult.parsingErrors.empty()) << code;
+    auto result = GenerateCode(std::move(encodingResult.code));
+    ExpectSameResult(result, expected, code);
+}
+
+/// <summary>
+/// Generates a data segment with the labels d0, d1 and d2. The labels are moved by random numbers
+/// of words, which changes the encoding of la, and some of them are around 0x10010000, where lui
+/// alone is enough.
+/// </summary>
+std::string GenerateDataSegment(std::mt19937& random)
+{
+    std::string code = ".data\n";
+    for (int label = 0; label < 3; ++label)
+    {
+        size_t numWords = random() % 4 == 0 ? 16383 + random() % 3 : random() % 80;
+        for (; numWords != 0; --numWords) code += ".word 0\n";
+        code += "d" + std::to_string(label) + ": .word 1\n";
+    }
+    return code;
+}
+
+// ------------------------------------------  Tests ------------------------------------------- //
+
 TEST(GenerationTest, ValidCode1)
 {
     auto tokenizationResult = Tokenize(_validCode1);
@@ -187,4 +258,365 @@ TEST(GenerationTest, ValidCode2)
         auto const& text = code.text;
         ASSERT_EQ_VECTOR(text, expected, *lit, *rit);
     }
-}
\ No newline at end of file
+}
+
+TEST(GenerationTest, LabelErrors)
+{
+    auto tokenizationResult = Tokenize(".data\n"
+                                       "var: .word 1\n"
+                                       ".text\n"
+                                       "main: j nowhere\n"
+                                       "var: jr $31\n"
+                                       "beq $1, $2, main\n"
+                                       "beq $1, $2, Main\n");
+    ASSERT_TRUE(tokenizationResult.errors.empty());
+
+    auto parsingResult = Parse(tokenizationResult.tokens);
+    ASSERT_TRUE(parsingResult.errors.empty());
+
+    auto generationResult = GenerateCode(parsingResult.fragments);
+    ASSERT_TRUE(std::holds_alternative<CannotGenerate>(generationResult));
+
+    // labels are case-sensitive
+    std::vector<std::pair<GenerationError::Type, uint32_t>> expected {
+        { GenerationError::Type::LabelAlreadyDefined, 5 },
+    };
+
+    auto const& errors = std::get<CannotGenerate>(generationResult).errors;
+    ASSERT_EQ_VECTOR(errors, expected, lit->type, rit->first);
+    ASSERT_EQ_VECTOR(errors, expected, lit->range.begin.line, rit->second);
+
+    // undefined labels are reported after the labels are scanned
+    parsingResult.fragments.erase(parsingResult.fragments.begin() + 6);
+    generationResult = GenerateCode(parsingResult.fragments);
+    ASSERT_TRUE(std::holds_alternative<CannotGenerate>(generationResult));
+
+    expected = {
+        { GenerationError::Type::UndefinedLabelName, 4 },
+        { GenerationError::Type::UndefinedLabelName, 7 },
+    };
+
+    auto const& undefinedErrors = std::get<CannotGenerate>(generationResult).errors;
+    ASSERT_EQ_VECTOR(undefinedErrors, expected, lit->type, rit->first);
+    ASSERT_EQ_VECTOR(undefinedErrors, expected, lit->range.begin.line, rit->second);
+}
+
+TEST(GenerationTest, EncodedCode)
+{
+    ExpectSameAsFragments(_validCode1);
+    ExpectSameAsFragments(_validCode2);
+
+    // the skipped jump moves the branch, which is then close enough to the label
+    ExpectSameAsFragments("far:\n" + Repeat("addu $1, $2, $3\n", 32767)
+                          + "j nowhere\nbeq $1, $2, far\n");
+
+    // clang-format off
+    char const* const statements[] = {
+        ".word 7", "addu $1, $2, $3", "lw $1, 4($2)", "t0:", "t1:", "la $4, d0", "la $4, d1",
+        "la $4, d2", "beq $1, $2, t0", "bne $1, $2, t1", "j t0", "jal t1", "j d0", "la $4, t0",
+        "j t2", ".data", ".text",
+    };
+    // clang-format on
+
+    std::mt19937 random { 42 };
+    for (int i = 0; i < 500; ++i)
+    {
+        auto code = GenerateDataSegment(random);
+
+        code += ".text\n";
+        for (size_t n = 1 + random() % 20; n != 0; --n)
+        {
+            code += statements[random() % (random() % 8 == 0 ? std::size(statements) : 12)];
+            code += '\n';
+        }
+        ExpectSameAsFragments(code);
+    }
+}
+
+TEST(GenerationTest, LoadAddress)
+{
+    std::string const codes[] = {
+        // the data segment after the text segment
+        "la $4, d\nlw $2, 0($4)\n.data\n.word 0\nd: .word 5\n",
+        // the lower half of the address is wider than a byte
+        ".data\n" + Repeat(".word 0\n", 64) + "d: .word 5\n.text\nla $4, d\n",
+        // labels in the text segment, before and after
+        "t: la $4, t\nla $5, u\nu: jr $31\n",
+        // 0x00410000 needs only lui, which puts u at that address
+        "la $4, u\n" + Repeat("addu $1, $2, $3\n", 16383) + "u: jr $31\n",
+        // lui and ori put u at 0x00410000, where lui is enough, but the size does not shrink back
+        "la $4, u\n" + Repeat("addu $1, $2, $3\n", 16382) + "u: jr $31\n",
+    };
+
+    // pairs of indices and words
+    std::vector<std::pair<size_t, uint32_t>> const expected[] = {
+        {
+            { 0, 0x3C041000 }, // lui $4, 0x1000
+            { 1, 0x34840004 }, // ori $4, $4, 0x0004
+            { 2, 0x8C820000 }, // lw $2, 0($4)
+        },
+        {
+            { 0, 0x3C041000 },
+            { 1, 0x34840100 }, // ori $4, $4, 0x0100
+        },
+        {
+            { 0, 0x3C040040 }, // lui $4, 0x0040
+            { 1, 0x3C050040 }, // lui $5, 0x0040
+            { 2, 0x34A5000C }, // ori $5, $5, 0x000C
+            { 3, 0x03E00008 }, // jr $31
+        },
+        {
+            { 0, 0x3C040041 }, // lui $4, 0x0041
+            { 16384, 0x03E00008 },
+        },
+        {
+            { 0, 0x3C040041 },
+            { 1, 0x34840000 }, // ori $4, $4, 0
+            { 16384, 0x03E00008 },
+        },
+    };
+    size_t const expectedSizes[] = { 3, 2, 4, 16385, 16385 };
+
+    for (size_t i = 0; i < std::size(codes); ++i)
+    {
+        SCOPED_TRACE(i);
+        ExpectWords(codes[i], {}, expected[i], expectedSizes[i]);
+    }
+}
+
+TEST(GenerationTest, UndefinedLabelsAndFarBranches)
+{
+    auto body = Repeat("addu $1, $2, $3\n", 32767);
+
+    // the branches are checked even if a label is not defined, and the errors are in the order of
+    // the code
+    std::string const code = "j nowhere\nbeq $1, $2, far\n" + body
+                             + "far:\nbeq $1, $2, nowhere\nj far2\n.data\nbeq $1, $2, far\n";
+
+    using Type = GenerationError::Type;
+    std::vector<std::pair<Type, size_t>> const expected[] = {
+        {
+            { Type::UndefinedLabelName, 1 },
+            { Type::BranchTargetTooFar, 2 },
+            { Type::UndefinedLabelName, 32771 },
+            { Type::UndefinedLabelName, 32772 },
+            { Type::BranchTargetTooFar, 32774 },
+        },
+        // the branch of the text segment is relaxed, and the one of the data segment is not
+        {
+            { Type::UndefinedLabelName, 1 },
+            { Type::UndefinedLabelName, 32771 },
+            { Type::UndefinedLabelName, 32772 },
+            { Type::BranchTargetTooFar, 32774 },
+        },
+    };
+
+    for (bool relaxBranches : { false, true })
+    {
+        GenerationOptions options;
+        options.relaxBranches = relaxBranches;
+
+        auto parsingResult    = ParseCode(code).parseResult;
+        auto generationResult = GenerateCode(parsingResult.fragments, options);
+        ASSERT_TRUE(std::holds_alternative<CannotGenerate>(generationResult)) << relaxBranches;
+
+        auto const& errors         = std::get<CannotGenerate>(generationResult).errors;
+        auto const& expectedErrors = expected[relaxBranches];
+        ASSERT_EQ(errors.size(), expectedErrors.size()) << relaxBranches;
+        for (size_t i = 0; i < errors.size(); ++i)
+        {
+            EXPECT_EQ(errors[i].type, expectedErrors[i].first) << relaxBranches << ' ' << i;
+            EXPECT_EQ(errors[i].range.begin.line, expectedErrors[i].second)
+                << relaxBranches << ' ' << i;
+        }
+    }
+}
+
+TEST(GenerationTest, FarBranches)
+{
+    auto body = Repeat("addu $1, $2, $3\n", 32767);
+
+    // a backward branch is completed as soon as it is generated, and a forward branch is completed
+    // after the label is found
+    std::string const codes[] = {
+        "far:\n" + body + "beq $1, $2, far\n",
+        "beq $1, $2, far\n" + body + "far:\n",
+        "far:\n" + body + "addu $1, $2, $3\nbeq $1, $2, far\n",
+        "beq $1, $2, far\n" + body + "addu $1, $2, $3\nfar:\n",
+    };
+    uint32_t const expectedOffsets[] = { 0x8000, 0x7FFF };
+
+    GenerationOptions options;
+    options.relaxBranches = false;
+
+    for (size_t i = 0; i < std::size(codes); ++i)
+    {
+        auto parsingResult    = ParseCode(codes[i]).parseResult;
+        auto generationResult = GenerateCode(parsingResult.fragments, options);
+        if (i < 2)
+        {
+            ASSERT_TRUE(std::holds_alternative<CanGenerate>(generationResult)) << i;
+            auto const& text   = std::get<CanGenerate>(generationResult).text;
+            auto const& branch = i == 0 ? text.back() : text.front();
+            EXPECT_EQ(branch & 0xFFFF, expectedOffsets[i]) << i;
+        }
+        else
+        {
+            ASSERT_TRUE(std::holds_alternative<CannotGenerate>(generationResult)) << i;
+            auto const& errors = std::get<CannotGenerate>(generationResult).errors;
+            ASSERT_EQ(errors.size(), 1) << i;
+            EXPECT_EQ(errors[0].type, GenerationError::Type::BranchTargetTooFar) << i;
+            EXPECT_EQ(errors[0].range.begin.line, i == 2 ? 32770 : 1) << i;
+        }
+    }
+}
+
+TEST(GenerationTest, RelaxedBranches)
+{
+    std::string const codes[] = {
+        // a backward branch and a forward branch one word too far
+        "far:\n" + Repeat("addu $1, $2, $3\n", 32768) + "beq $1, $2, far\n",
+        "beq $1, $2, far\n" + Repeat("addu $1, $2, $3\n", 32768) + "far:\n",
+        // relaxing the second branch moves near, so the first branch is relaxed too
+        "beq $1, $2, near\n" + Repeat("addu $1, $2, $3\n", 32766) + "beq $3, $4, far\n"
+            + "near:\n" + Repeat("addu $1, $2, $3\n", 32768) + "far:\n",
+        // j cannot reach the data segment
+        ".data\nd: .word 7\n.text\nj d\njal d\nbeq $1, $2, d\n",
+    };
+
+    // pairs of indices and words
+    std::vector<std::pair<size_t, uint32_t>> const expected[] = {
+        {
+            { 32768, 0x14220001 }, // bne $1, $2, 1
+            { 32769, 0x08100000 }, // j 0x00400000
+        },
+        {
+            { 0, 0x14220001 },
+            { 1, 0x08108002 }, // j 0x00420008
+        },
+        {
+            { 0, 0x14220001 },
+            { 1, 0x08108002 },
+            { 32768, 0x14640001 }, // bne $3, $4, 1
+            { 32769, 0x08110002 }, // j 0x00440008
+        },
+        {
+            { 0, 0x3C011000 }, // lui $1, 0x1000
+            { 1, 0x34210000 }, // ori $1, $1, 0
+            { 2, 0x00200008 }, // jr $1
+            { 3, 0x3C011000 },
+            { 4, 0x34210000 },
+            { 5, 0x0020F809 }, // jalr $31, $1
+            { 6, 0x14220003 }, // bne $1, $2, 3
+            { 7, 0x3C011000 },
+            { 8, 0x34210000 },
+            { 9, 0x00200008 },
+        },
+    };
+    size_t const expectedSizes[] = { 32770, 32770, 65538, 10 };
+
+    for (size_t i = 0; i < std::size(codes); ++i)
+    {
+        SCOPED_TRACE(i);
+        ExpectWords(codes[i], {}, expected[i], expectedSizes[i]);
+    }
+}
+
+TEST(GenerationTest, RelaxedBranchesWithDelaySlots)
+{
+    std::string const codes[] = {
+        "beq $1, $2, far\nsll $0, $0, 0\n" + Repeat("addu $1, $2, $3\n", 32768) + "far:\n",
+        // the jumps are the same as without delay slots
+        ".data\nd: .word 7\n.text\nbeq $1, $2, d\naddu $3, $4, $5\njal d\naddu $3, $4, $5\n",
+    };
+
+    // pairs of indices and words
+    std::vector<std::pair<size_t, uint32_t>> const expected[] = {
+        {
+            { 0, 0x14220002 }, // bne $1, $2, 2
+            { 1, 0x00000000 }, // nop
+            { 2, 0x08108004 }, // j 0x00420010
+            { 3, 0x00000000 }, // the delay slot of the beq
+        },
+        {
+            { 0, 0x14220004 }, // bne $1, $2, 4
+            { 1, 0x00000000 },
+            { 2, 0x3C011000 }, // lui $1, 0x1000
+            { 3, 0x34210000 }, // ori $1, $1, 0
+            { 4, 0x00200008 }, // jr $1
+            { 5, 0x00851821 }, // addu $3, $4, $5
+            { 6, 0x3C011000 },
+            { 7, 0x34210000 },
+            { 8, 0x0020F809 }, // jalr $31, $1
+            { 9, 0x00851821 },
+        },
+    };
+    size_t const expectedSizes[] = { 32772, 10 };
+
+    GenerationOptions options;
+    options.hasDelaySlots = true;
+    for (size_t i = 0; i < std::size(codes); ++i)
+    {
+        SCOPED_TRACE(i);
+        ExpectWords(codes[i], options, expected[i], expectedSizes[i]);
+    }
+}
+
+TEST(GenerationTest, Parallel)
+{
+    ParallelOptions parallelOptions;
+    parallelOptions.numThreads = 4;
+    parallelOptions.chunkSize  = 16;
+
+    std::mt19937 random { 42 };
+    for (int i = 0; i < 200; ++i)
+    {
+        auto code = GenerateDataSegment(random);
+
+        // every label is defined once, and the segment changes in the middle of chunks
+        int numLabels = 1 + random() % 20;
+        code += ".text\n";
+        for (int label = 0; label < numLabels; ++label)
+        {
+            code += "t" + std::to_string(label) + ":\n";
+            for (size_t n = random() % 30; n != 0; --n)
+            {
+                auto target = std::to_string(random() % numLabels);
+                switch (random() % 9)
+                {
+                case 0: code += "beq $1, $2, t" + target + "\n"; break;
+                case 1: code += "j t" + target + "\n"; break;
+                case 2: code += "la $4, d" + std::to_string(random() % 3) + "\n"; break;
+                case 3: code += random() % 2 == 0 ? ".data\n.word 5\n.text\n" : ".word 6\n"; break;
+                default: code += "addu $1, $2, $3\n"; break;
+                }
+            }
+        }
+
+        // some of the codes have an error
+        if (random() % 4 == 0)
+            code += random() % 2 == 0 ? "t0:\n" : "j nowhere\n";
+
+        auto parsingResult = ParseCode(code).parseResult;
+        ASSERT_TRUE(parsingResult.errors.empty());
+
+        auto expected = GenerateCode(parsingResult.fragments);
+        auto result   = GenerateCodeParallel(parsingResult.fragments, {}, parallelOptions);
+        ExpectSameResult(result, expected, code);
+    }
+
+    // the code which needs relaxation is generated by the serial version
+    std::string const farCodes[] = {
+        "far:\n" + Repeat("addu $1, $2, $3\n", 32768) + "beq $1, $2, far\n",
+        "beq $1, $2, far\n" + Repeat("addu $1, $2, $3\n", 32768) + "far:\n",
+        ".data\nd: .word 7\n.text\n" + Repeat("addu $1, $2, $3\n", 100) + "j d\n",
+    };
+    for (auto const& code : farCodes)
+    {
+        auto parsingResult = ParseCode(code).parseResult;
+        auto expected      = GenerateCode(parsingResult.fragments);
+        ASSERT_TRUE(std::holds_alternative<CanGenerate>(expected));
+        ExpectSameResult(GenerateCodeParallel(parsingResult.fragments, {}, parallelOptions),
+                         expected);
+    }
+}
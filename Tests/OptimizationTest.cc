@@ -0,0 +1,187 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <gtest/gtest.h>
+#include <simple-mips-asm/Generation.hh>
+#include <simple-mips-asm/Optimization.hh>
+#include <simple-mips-asm/Parsing.hh>
+
+#include "TestCommon.hh"
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+/// <summary>
+/// Optimizes the given code, and checks the removed instructions and that the result is the same
+/// as the code generated from the given expected code.
+/// </summary>
+void ExpectOptimized(char const*                                                    code,
+                     char const*                                                    expectedCode,
+                     std::vector<std::pair<RemovedInstruction::Type, uint32_t>> const& expected,
+                     OptimizationOptions const& options = {})
+{
+    auto parseResult = ParseCode(code).parseResult;
+    ASSERT_TRUE(parseResult.errors.empty()) << code;
+
+    auto const& removed = Optimize(parseResult.fragments, options).removedInstructions;
+    ASSERT_EQ_VECTOR(removed, expected, lit->type, rit->first);
+    ASSERT_EQ_VECTOR(removed, expected, lit->range.begin.line, rit->second);
+
+    auto expectedResult = GenerateCode(ParseCode(expectedCode).parseResult.fragments);
+    ASSERT_TRUE(std::holds_alternative<CanGenerate>(expectedResult)) << expectedCode;
+    ExpectSameResult(GenerateCode(parseResult.fragments), expectedResult, code);
+}
+
+}
+
+TEST(OptimizationTest, NoOps)
+{
+    using Type = RemovedInstruction::Type;
+
+    ExpectOptimized("main:\n"
+                    "sll $0, $0, 0\n"
+                    "addiu $2, $2, 0\n"
+                    "addiu $2, $3, 0\n"
+                    "ori $4, $4, 0\n"
+                    "lui $0, 1\n"
+                    "addu $5, $0, $5\n"
+                    "or $6, $6, $6\n"
+                    "subu $7, $0, $7\n"
+                    "srl $8, $8, 0\n"
+                    "sll $8, $8, 1\n"
+                    "lw $0, 0($4)\n"
+                    "la $0, main\n"
+                    "jr $31\n",
+                    "main:\n"
+                    "addiu $2, $3, 0\n"
+                    "subu $7, $0, $7\n"
+                    "sll $8, $8, 1\n"
+                    "lw $0, 0($4)\n"
+                    "jr $31\n",
+                    {
+                        { Type::WriteToZero, 2 },
+                        { Type::SelfAssignment, 3 },
+                        { Type::SelfAssignment, 5 },
+                        { Type::WriteToZero, 6 },
+                        { Type::SelfAssignment, 7 },
+                        { Type::SelfAssignment, 8 },
+                        { Type::SelfAssignment, 10 },
+                        { Type::WriteToZero, 13 },
+                    });
+}
+
+TEST(OptimizationTest, BranchesToNext)
+{
+    using Type = RemovedInstruction::Type;
+
+    // the jump becomes a jump to the next instruction once the no-op is removed, and a branch to
+    // itself is kept
+    ExpectOptimized("main: j a\n"
+                    "addu $0, $1, $2\n"
+                    "a: beq $1, $2, b\n"
+                    "b: bne $1, $2, c\n"
+                    "c: jal d\n"
+                    "d: j e\n"
+                    ".data\n"
+                    "e: .word 0\n"
+                    ".text\n"
+                    "beq $1, $2, main\n"
+                    "loop: j loop\n",
+                    "main: a: b: c: jal d\n"
+                    "d: j e\n"
+                    ".data\n"
+                    "e: .word 0\n"
+                    ".text\n"
+                    "beq $1, $2, main\n"
+                    "loop: j loop\n",
+                    {
+                        { Type::BranchToNext, 1 },
+                        { Type::WriteToZero, 2 },
+                        { Type::BranchToNext, 3 },
+                        { Type::BranchToNext, 4 },
+                    });
+}
+
+TEST(OptimizationTest, DelaySlots)
+{
+    using Type = RemovedInstruction::Type;
+
+    OptimizationOptions options;
+    options.hasDelaySlots = true;
+
+    // the instructions in the delay slots are kept, and so is the jump to its delay slot
+    ExpectOptimized("main: beq $1, $2, a\n"
+                    "sll $0, $0, 0\n"
+                    "addu $0, $1, $2\n"
+                    "a: j b\n"
+                    "b: addu $2, $3, $4\n"
+                    "jr $31\n"
+                    "c: addu $0, $1, $2\n",
+                    "main: beq $1, $2, a\n"
+                    "sll $0, $0, 0\n"
+                    "a: j b\n"
+                    "b: addu $2, $3, $4\n"
+                    "jr $31\n"
+                    "c: addu $0, $1, $2\n",
+                    {
+                        { Type::WriteToZero, 3 },
+                    },
+                    options);
+}
+
+TEST(OptimizationTest, DataSegment)
+{
+    using Type = RemovedInstruction::Type;
+
+    // the instructions in the data segment are data words, so moving them would move the labels
+    // after them and change the loaded values
+    ExpectOptimized(".data\n"
+                    "table: sll $0, $0, 0\n"
+                    "addu $0, $1, $2\n"
+                    "beq $1, $2, next\n"
+                    "next: lw $2, 0($4)\n"
+                    ".text\n"
+                    "la $4, table\n"
+                    "lw $2, 4($4)\n"
+                    "sll $0, $0, 0\n",
+                    ".data\n"
+                    "table: sll $0, $0, 0\n"
+                    "addu $0, $1, $2\n"
+                    "beq $1, $2, next\n"
+                    "next: lw $2, 0($4)\n"
+                    ".text\n"
+                    "la $4, table\n"
+                    "lw $2, 4($4)\n",
+                    {
+                        { Type::WriteToZero, 9 },
+                    });
+}
+
+TEST(OptimizationTest, UndefinedLabels)
+{
+    // the la of the undefined label is kept, so the code generator still reports it, and the la
+    // of the label defined after it is removed
+    char const* code = "main: la $0, nowhere\n"
+                       "la $0, table\n"
+                       "jr $31\n"
+                       ".data\n"
+                       "table: .word 0\n";
+
+    auto parseResult = ParseCode(code).parseResult;
+    ASSERT_TRUE(parseResult.errors.empty());
+
+    auto const& removed = Optimize(parseResult.fragments).removedInstructions;
+    ASSERT_EQ(removed.size(), 1);
+    EXPECT_EQ(removed[0].type, RemovedInstruction::Type::WriteToZero);
+    EXPECT_EQ(removed[0].range.begin.line, 2);
+
+    auto generationResult = GenerateCode(parseResult.fragments);
+    ASSERT_TRUE(std::holds_alternative<CannotGenerate>(generationResult));
+
+    auto const& errors = std::get<CannotGenerate>(generationResult).errors;
+    ASSERT_EQ(errors.size(), 1);
+    EXPECT_EQ(errors[0].type, GenerationError::Type::UndefinedLabelName);
+    EXPECT_EQ(errors[0].range.begin.line, 1);
+}
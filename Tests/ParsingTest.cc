@@ -6,7 +6,15 @@
 #include <simple-mips-asm/Tokenization.hh>
 
 #include "TestCommon.hh"
+#include <algorithm>
+#include <cctype>
 #include <cstring>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
 
 // ------------------------------------------  Codes ------------------------------------------- //
 
@@ -62,6 +70,30 @@ sum_exit:
 exit:
 )==";
 
+char const _commentedCode[] = R"==(
+# sums 1 to var
+        .data
+var:  .word   5     # the number to sum up to
+        .text
+main:
+    la $8, var
+    lw $9, 0($8)
+    addu $2, $0, $9
+    jal sum         # $4 = sum
+    j exit
+
+sum: sltiu $1, $2, 1
+    bne $1, $0, sum_exit
+    addu $3, $3, $2
+    addiu $2, $2, -1
+    j sum
+sum_exit:
+    addu $4, $3, $0
+    jr $31
+# end of the program
+exit:
+)==";
+
 // ------------------------------  Fragment comparison operators ------------------------------- //
 
 #pragma region Comparison Opreators
@@ -86,7 +118,7 @@ DEFINE_BITWISE_EQUALITY(WordDirData);
 
 constexpr bool operator==(LabelData const& lhs, LabelData const& rhs) noexcept
 {
-    return lhs.value == rhs.value;
+    return lhs.symbol == rhs.symbol;
 }
 
 DEFINE_BITWISE_EQUALITY(RFormatData);
@@ -127,8 +159,28 @@ constexpr bool operator==(LAFormatData const& lhs, LAFormatData const& rhs) noex
     return lhs.type == rhs.type && lhs.destination == rhs.destination && lhs.target == rhs.target;
 }
 
+constexpr bool operator==(Position const& lhs, Position const& rhs) noexcept
+{
+    return lhs.line == rhs.line && lhs.character == rhs.character;
+}
+
+constexpr bool operator==(Range const& lhs, Range const& rhs) noexcept
+{
+    return lhs.begin == rhs.begin && lhs.end == rhs.end;
+}
+
 #pragma endregion Comparison Operators
 
+/// <summary>
+/// Returns the names in the given symbol table in the order of their IDs.
+/// </summary>
+std::vector<std::string_view> NamesOf(SymbolTable const& symbols)
+{
+    std::vector<std::string_view> names;
+    for (SymbolId id = 0; id < symbols.size(); ++id) names.push_back(symbols.GetName(id));
+    return names;
+}
+
 // ------------------------------------------  Tests ------------------------------------------- //
 
 TEST(ParsingTest, ValidCode1)
@@ -144,19 +196,19 @@ TEST(ParsingTest, ValidCode1)
         // .data
         DataDirData {},
         // array: .word 3
-        LabelData { "array" }, WordDirData { 3 },
+        LabelData { 0 /* array */ }, WordDirData { 3 },
         // .word 123
         WordDirData { 123 },
         // .word 4346
         WordDirData { 4346 },
         // array2: .word 0x12345678
-        LabelData { "array2" }, WordDirData { 0x12345678 },
+        LabelData { 1 /* array2 */ }, WordDirData { 0x12345678 },
         // .word 0xFFFFFFFF
         WordDirData { 0xFFFFFFFF },
         // .text
         TextDirData {},
         // main:
-        LabelData { "main" },
+        LabelData { 2 /* main */ },
         // addiu $2, $0, 1024
         IFormatData { IFormatOperation::ADDIU, 2, 0, 1024 },
         // addu $3, $2, $2
@@ -180,7 +232,7 @@ TEST(ParsingTest, ValidCode1)
         // srl $12, $6, 4
         SRFormatData { SRFormatFunction::SRL, 12, 6, 4 },
         // la $4, array2
-        LAFormatData { LAFormatType::LA, 4, "array2" },
+        LAFormatData { LAFormatType::LA, 4, 1 /* array2 */ },
         // lb $2, 1($4)
         OIFormatData { OIFormatOperation::LB, 2, 1, 4 },
         // sb $2, 6($4)
@@ -212,6 +264,9 @@ TEST(ParsingTest, ValidCode1)
             ASSERT_EQ(lit->data, *rit);
         }
     }
+
+    std::vector<std::string_view> expectedSymbols { "array", "array2", "main" };
+    ASSERT_EQ(NamesOf(parsingResult.symbols), expectedSymbols);
 }
 
 TEST(ParsingTest, ValidCode2)
@@ -227,42 +282,459 @@ TEST(ParsingTest, ValidCode2)
         // .data
         DataDirData {},
         // var: .word 5
-        LabelData { "var" }, WordDirData { 5 },
+        LabelData { 0 /* var */ }, WordDirData { 5 },
         // .text
         TextDirData {},
         // main:
-        LabelData { "main" },
+        LabelData { 1 /* main */ },
         // la $8, var
-        LAFormatData { LAFormatType::LA, 8, "var" },
+        LAFormatData { LAFormatType::LA, 8, 0 /* var */ },
         // lw $9, 0($8)
         OIFormatData { OIFormatOperation::LW, 9, 0, 8 },
         // addu $2, $0, $9
         RFormatData { RFormatFunction::ADDU, 2, 0, 9 },
         // jal sum
-        JFormatData { JFormatOperation::JAL, "sum" },
+        JFormatData { JFormatOperation::JAL, 2 /* sum */ },
         // j exit
-        JFormatData { JFormatOperation::J, "exit" },
+        JFormatData { JFormatOperation::J, 3 /* exit */ },
         // sum: sltiu $1, $2, 1
-        LabelData { "sum" }, IFormatData { IFormatOperation::SLTIU, 1, 2, 1 },
+        LabelData { 2 /* sum */ }, IFormatData { IFormatOperation::SLTIU, 1, 2, 1 },
         // bne: $1, $0, sum_exit
-        BIFormatData { BIFormatOperation::BNE, 1, 0, "sum_exit" },
+        BIFormatData { BIFormatOperation::BNE, 1, 0, 4 /* sum_exit */ },
         // addu $3, $3, $2
         RFormatData { RFormatFunction::ADDU, 3, 3, 2 },
         // addiu $2, $2, -1
         IFormatData { IFormatOperation::ADDIU, 2, 2, 65535/* -1 */ },
         // j sum
-        JFormatData { JFormatOperation::J, "sum" },
+        JFormatData { JFormatOperation::J, 2 /* sum */ },
         // sum_exit:
-        LabelData { "sum_exit" },
+        LabelData { 4 /* sum_exit */ },
         // addu $4, $3, $0
         RFormatData { RFormatFunction::ADDU, 4, 3, 0 },
         // jr $31
         JRFormatData { JRFormatFunction::JR, 31 },
         // exit:
-        LabelData { "exit" },
+        LabelData { 3 /* exit */ },
+    };
+    // clang-format on
+
+    auto const& fragments = parsingResult.fragments;
+    ASSERT_EQ_VECTOR(fragments, expected, lit->data, *rit);
+
+    std::vector<std::string_view> expectedSymbols { "var", "main", "sum", "exit", "sum_exit" };
+    ASSERT_EQ(NamesOf(parsingResult.symbols), expectedSymbols);
+}
+
+TEST(ParsingTest, CompactTokens)
+{
+    auto tokenizationResult = TokenizeCompact(_validCode2);
+    ASSERT_TRUE(tokenizationResult.errors.empty());
+
+    auto parsingResult = Parse(tokenizationResult.tokens);
+    ASSERT_TRUE(parsingResult.errors.empty());
+
+    auto expected = Parse(Tokenize(_validCode2).tokens);
+
+    auto const& fragments = parsingResult.fragments;
+    ASSERT_EQ_VECTOR(fragments, expected.fragments, lit->data, rit->data);
+    ASSERT_EQ_VECTOR(fragments, expected.fragments, lit->range, rit->range);
+    ASSERT_EQ(NamesOf(parsingResult.symbols), NamesOf(expected.symbols));
+}
+
+TEST(ParsingTest, TokenStream)
+{
+    std::string code = std::string { _validCode2 } + "addu $1, $2,\n    lb $2, 0x5($4)";
+
+    auto expected = Parse(Tokenize(code).tokens);
+
+    TokenStream stream { code };
+    auto        parsingResult = Parse(stream);
+    ASSERT_TRUE(stream.GetErrors().empty());
+
+    auto const& fragments = parsingResult.fragments;
+    ASSERT_EQ_VECTOR(fragments, expected.fragments, lit->data, rit->data);
+    ASSERT_EQ_VECTOR(fragments, expected.fragments, lit->range, rit->range);
+    ASSERT_EQ(NamesOf(parsingResult.symbols), NamesOf(expected.symbols));
+
+    auto const& errors = parsingResult.errors;
+    ASSERT_EQ_VECTOR(errors, expected.errors, lit->type, rit->type);
+    ASSERT_EQ_VECTOR(errors, expected.errors, lit->range, rit->range);
+}
+
+TEST(ParsingTest, Dispatch)
+{
+    auto firstError = [](char const* code) {
+        auto parsingResult = Parse(Tokenize(code).tokens);
+        EXPECT_FALSE(parsingResult.errors.empty());
+        return parsingResult.errors.empty() ? ParsingError {} : parsingResult.errors[0];
+    };
+
+    // a mnemonic followed by a colon is a label
+    auto parsingResult = Parse(Tokenize("addu:").tokens);
+    ASSERT_TRUE(parsingResult.errors.empty());
+    ASSERT_EQ(parsingResult.fragments.size(), 1);
+    auto label = std::get<LabelData>(parsingResult.fragments[0].data);
+    ASSERT_EQ(parsingResult.symbols.GetName(label.symbol), "addu");
+
+    // clang-format off
+    std::vector<std::pair<char const*, ParsingError>> cases {
+        // not a directive
+        { ".wrd 1",         { ParsingError::Type::UnexpectedValue, { 1, 2, 1, 5 } } },
+        { ".addu",          { ParsingError::Type::UnexpectedValue, { 1, 2, 1, 6 } } },
+        // neither a mnemonic nor a label
+        { "foo $1",         { ParsingError::Type::UnexpectedToken, { 1, 5, 1, 6 } } },
+        { "data",           { ParsingError::Type::UnexpectedEof,   { 1, 5, 1, 5 } } },
+        // errors in operands
+        { "addu $1 $2, $3", { ParsingError::Type::UnexpectedToken, { 1, 9, 1, 10 } } },
+        { "jal 0x10",       { ParsingError::Type::UnexpectedToken, { 1, 5, 1, 9 } } },
+        { ".word",          { ParsingError::Type::UnexpectedEof,   { 1, 6, 1, 6 } } },
+        { "1",              { ParsingError::Type::UnexpectedToken, { 1, 1, 1, 2 } } },
+    };
+    // clang-format on
+
+    for (auto const& [code, expected] : cases)
+    {
+        auto error = firstError(code);
+        EXPECT_EQ(error.type, expected.type) << code;
+        EXPECT_EQ(error.range, expected.range) << code;
+    }
+}
+
+TEST(ParsingTest, InstructionTable)
+{
+    // sample operands of each format
+    char const* const operands[NumFormats] {
+        "$1, $2, $3", "$1", "$1, $2, 3", "$1, $2, 4", "$1, $2, x",
+        "$1, 4",      "$1, 4($2)",      "x",          "$1, x",
+    };
+
+    for (auto const& instruction : Instructions)
+    {
+        auto format = static_cast<size_t>(instruction.format);
+        auto code   = std::string(instruction.mnemonic) + " " + operands[format];
+        auto upper  = code;
+        std::transform(upper.begin(), upper.end(), upper.begin(), [](char c) {
+            return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        });
+
+        for (auto const& line : { code, upper })
+        {
+            auto parsingResult = Parse(Tokenize(line).tokens);
+            auto codeResult    = ParseCode(line).parseResult;
+            ASSERT_TRUE(parsingResult.errors.empty()) << line;
+            ASSERT_EQ(parsingResult.fragments.size(), 1) << line;
+            ASSERT_EQ(codeResult.fragments.size(), 1) << line;
+
+            // instructions follow the directives and the labels in FragmentData
+            EXPECT_EQ(parsingResult.fragments[0].data.index(), 4 + format) << line;
+            EXPECT_EQ(codeResult.fragments[0].data.index(), 4 + format) << line;
+        }
+    }
+}
+
+TEST(ParsingTest, RegisterAliases)
+{
+    auto tokenizationResult = Tokenize("ADDU $t0, $SP, $ra\n"
+                                       "Lw   $zero, 4($Fp)\n"
+                                       "jr   $31\n");
+    ASSERT_TRUE(tokenizationResult.errors.empty());
+
+    auto parsingResult = Parse(tokenizationResult.tokens);
+
+    // clang-format off
+    std::vector<FragmentData> expected {
+        RFormatData { RFormatFunction::ADDU, 8, 29, 31 },
+        OIFormatData { OIFormatOperation::LW, 0, 4, 30 },
+        JRFormatData { JRFormatFunction::JR, 31 },
     };
     // clang-format on
 
     auto const& fragments = parsingResult.fragments;
     ASSERT_EQ_VECTOR(fragments, expected, lit->data, *rit);
+
+    ASSERT_TRUE(parsingResult.errors.empty());
+
+    for (auto code : { "or $1, $t10, $2", "or $1, $data, $2" })
+    {
+        auto errors = Parse(Tokenize(code).tokens).errors;
+        ASSERT_FALSE(errors.empty());
+        ASSERT_EQ(errors[0].type, ParsingError::Type::UnexpectedValue);
+        ASSERT_EQ(errors[0].range.begin, (Position { 1, 9 }));
+    }
+}
+
+TEST(ParsingTest, Recovery)
+{
+    auto tokenizationResult = Tokenize("addu $1, $2 $3, $4, $5\n"
+                                       "label: jr $31 $31 jr $31\n"
+                                       ".word 1 2 3\n"
+                                       "        jr $31\n");
+    ASSERT_TRUE(tokenizationResult.errors.empty());
+
+    auto parsingResult = Parse(tokenizationResult.tokens);
+
+    // clang-format off
+    std::vector<FragmentData> expected {
+        LabelData { 0 /* label */ },
+        JRFormatData { JRFormatFunction::JR, 31 },
+    };
+    // clang-format on
+
+    auto const& fragments = parsingResult.fragments;
+    ASSERT_EQ_VECTOR(fragments, expected, lit->data, *rit);
+
+    // one error for each line
+    std::vector<Range> expectedErrors {
+        Range { 1, 13, 1, 14 },
+        Range { 2, 15, 2, 16 },
+        Range { 3, 9, 3, 10 },
+    };
+
+    auto const& errors = parsingResult.errors;
+    ASSERT_EQ_VECTOR(errors, expectedErrors, lit->range, *rit);
+}
+
+TEST(ParsingTest, MaxErrors)
+{
+    std::string code;
+    for (int i = 0; i < 10; ++i) code += "addu $1\n";
+
+    TokenizationOptions tokenizationOptions;
+    tokenizationOptions.elideWhitespaces = true;
+
+    ParseOptions options;
+    options.maxErrors = 3;
+
+    auto tokenizationResult = Tokenize(code, tokenizationOptions);
+    ASSERT_EQ(Parse(tokenizationResult.tokens).errors.size(), 10);
+    ASSERT_EQ(Parse(tokenizationResult.tokens, options).errors.size(), 3);
+
+    TokenStream stream { code, tokenizationOptions };
+    auto        errors = Parse(stream, options).errors;
+    ASSERT_EQ(errors.size(), 3);
+    ASSERT_EQ(errors[2].range, (Range { 3, 8, 4, 1 }));
+}
+
+// ------------------------------------  Pathological inputs ----------------------------------- //
+
+/// <summary>
+/// Generates inputs of the given size which are hard to tokenize or parse.
+/// </summary>
+std::vector<std::pair<char const*, std::function<std::string(size_t)>>> const _pathologicalInputs {
+    { "random bytes",
+      [](size_t size) {
+          std::mt19937 random { 42 };
+          std::string  code(size, '\0');
+          for (auto& c : code) c = static_cast<char>(random());
+          return code;
+      } },
+    { "random tokens without new lines",
+      [](size_t size) {
+          char const   pieces[] = "$,():.# 0x1a_";
+          std::mt19937 random { 42 };
+          std::string  code(size, '\0');
+          for (auto& c : code) c = pieces[random() % (sizeof(pieces) - 1)];
+          return code;
+      } },
+    { "instructions without new lines",
+      [](size_t size) {
+          std::string code;
+          while (code.size() < size) code += "addu $1, $2, $3 ";
+          return code;
+      } },
+    { "truncated instructions",
+      [](size_t size) {
+          std::string code;
+          while (code.size() < size) code += "lw $1, 4($2\n";
+          return code;
+      } },
+    { "labels",
+      [](size_t size) {
+          std::string code;
+          while (code.size() < size) code += "a:";
+          return code;
+      } },
+    { "long word", [](size_t size) { return std::string(size, 'a'); } },
+    { "whitespaces", [](size_t size) { return std::string(size, ' '); } },
+};
+
+TEST(ParsingTest, PathologicalInputs)
+{
+    // the time is measured by ParsingBenchmark, since a ratio of times flakes on a loaded machine
+    for (auto const& [name, generate] : _pathologicalInputs)
+    {
+        for (size_t size : { 1 << 10, 64 << 10, 512 << 10 })
+        {
+            auto code               = generate(size);
+            auto tokenizationResult = Tokenize(code);
+            auto parsingResult      = Parse(tokenizationResult.tokens);
+
+            // The parser resumes at the next line after an error, so there is at most one error
+            // for each line, and each fragment or error consumes at least one token.
+            auto numLines  = static_cast<size_t>(std::count(code.begin(), code.end(), '\n') + 1);
+            auto numTokens = tokenizationResult.tokens.size();
+            EXPECT_LE(parsingResult.errors.size(), numLines) << name << ' ' << size;
+            EXPECT_LE(parsingResult.fragments.size() + parsingResult.errors.size(), numTokens)
+                << name << ' ' << size;
+        }
+    }
+}
+
+/// <summary>
+/// Generates code of the given number of lines, most of which are well-formed statements with
+/// random spacing, comments and case, and the rest are random tokens.
+/// </summary>
+std::string GenerateRandomCode(std::mt19937& random, size_t numLines)
+{
+    // clang-format off
+    char const* const statements[] = {
+        // well-formed statements
+        "addu $1, $2, $3", "SUBU $t0,$t1,$t2", "sll $2, $3, 31", "srl $ra,$0,0x1F",
+        "addiu $sp, $sp, -32768", "ori $1, $2, 0xFFFF", "lui $at, 65535", "lw $1, 4($2)",
+        "SW $s0, -4 ( $fp )", "lb $1,0x10($2)", "beq $1, $2, lab", "bne $a0,$zero,loop_1",
+        "j main", "jal _f", "la $4, array", "jr $ra", ".data", ".text", ".word 4294967295",
+        ". word 0x0", "lab:", "x1 :", "lab: jr $31", ".text addu $1, $2, $3", "a:b:.data",
+        // statements with errors
+        "andi $1,$2,65536", "sll $1,$2,32", "addu $1, $2", "lw $1, 4($2", "jr $32", "j 10",
+        "addu $1, $2, $3 x", "j main x", "la $4, array,", "jr $foo", ".word -1",
+        "addiu $1, $2, 10a", "or $1, $2, $0x1",
+    };
+    char const* const pieces[] = {
+        "$1", "$t0", "$", ",", "(", ")", ":", ".", "0x", "0x1g", "-", "-1", "lab", "addu", "data",
+        "word", " ", "\t", "\r", "#", "@", "\xFF", "1a", "_",
+    };
+    // clang-format on
+    char const* const spaces[] = { "", " ", "\t", "  ", "\r" };
+
+    std::string code;
+    for (size_t i = 0; i < numLines; ++i)
+    {
+        if (random() % 8 == 0)
+        {
+            for (size_t n = random() % 8; n != 0; --n) code += pieces[random() % std::size(pieces)];
+        }
+        else
+        {
+            code += spaces[random() % std::size(spaces)];
+            for (char const* c = statements[random() % std::size(statements)]; *c != '\0'; ++c)
+            {
+                if (*c == ' ')
+                    code += spaces[1 + random() % (std::size(spaces) - 1)];
+                else
+                    code += *c;
+                if (random() % 8 == 0)
+                    code += spaces[random() % std::size(spaces)];
+            }
+            if (random() % 4 == 0)
+                code += " # comment $1, @";
+        }
+
+        if (i + 1 < numLines || random() % 2 == 0)
+            code += '\n';
+    }
+    return code;
+}
+
+TEST(ParsingTest, ParseCode)
+{
+    std::mt19937 random { 42 };
+    for (int i = 0; i < 200; ++i)
+    {
+        auto code = GenerateRandomCode(random, 1 + random() % 100);
+        for (int flags = 0; flags < 4; ++flags)
+        {
+            TokenizationOptions tokenizationOptions;
+            tokenizationOptions.elideWhitespaces = (flags & 1) != 0;
+            tokenizationOptions.skipComments     = (flags & 2) != 0;
+
+            auto tokenizationResult = Tokenize(code, tokenizationOptions);
+            auto expected           = Parse(tokenizationResult.tokens);
+            auto result             = ParseCode(code, tokenizationOptions);
+
+            auto const& tokenizationErrors = result.tokenizationErrors;
+            ASSERT_EQ_VECTOR(
+                tokenizationErrors, tokenizationResult.errors, lit->type, rit->type);
+            ASSERT_EQ_VECTOR(
+                tokenizationErrors, tokenizationResult.errors, lit->range, rit->range);
+
+            auto const& fragments = result.parseResult.fragments;
+            ASSERT_EQ_VECTOR(fragments, expected.fragments, lit->data, rit->data);
+            ASSERT_EQ_VECTOR(fragments, expected.fragments, lit->range, rit->range);
+            ASSERT_EQ(NamesOf(result.parseResult.symbols), NamesOf(expected.symbols));
+
+            auto const& errors = result.parseResult.errors;
+            ASSERT_EQ_VECTOR(errors, expected.errors, lit->type, rit->type);
+            ASSERT_EQ_VECTOR(errors, expected.errors, lit->range, rit->range);
+        }
+    }
+}
+
+TEST(ParsingTest, Parallel)
+{
+    std::mt19937 random { 42 };
+    auto         code = GenerateRandomCode(random, 2000);
+
+    auto tokenizationResult = Tokenize(code);
+    auto compactResult      = TokenizeCompact(code);
+
+    auto const&        pmrTokens = tokenizationResult.tokens;
+    std::vector<Token> tokens { pmrTokens.begin(), pmrTokens.end() };
+
+    ParallelOptions parallelOptions;
+    parallelOptions.numThreads = 4;
+    parallelOptions.chunkSize  = 100;
+
+    for (size_t maxErrors : { 0, 1, 7, 100 })
+    {
+        ParseOptions options;
+        options.maxErrors = maxErrors;
+
+        auto expected = Parse(tokenizationResult.tokens, options);
+        for (auto const& result : {
+                 Parse(tokens, options),
+                 ParseParallel(tokenizationResult.tokens, options, parallelOptions),
+                 ParseParallel(tokens, options, parallelOptions),
+                 ParseParallel(compactResult.tokens, options, parallelOptions),
+             })
+        {
+            auto const& fragments = result.fragments;
+            ASSERT_EQ_VECTOR(fragments, expected.fragments, lit->data, rit->data);
+            ASSERT_EQ_VECTOR(fragments, expected.fragments, lit->range, rit->range);
+            ASSERT_EQ(NamesOf(result.symbols), NamesOf(expected.symbols));
+
+            auto const& errors = result.errors;
+            ASSERT_EQ_VECTOR(errors, expected.errors, lit->type, rit->type);
+            ASSERT_EQ_VECTOR(errors, expected.errors, lit->range, rit->range);
+        }
+    }
+}
+
+TEST(ParsingTest, UnexpectedEof)
+{
+    auto tokenizationResult = Tokenize("addu $1, $2,");
+    ASSERT_TRUE(tokenizationResult.errors.empty());
+
+    auto parsingResult = Parse(tokenizationResult.tokens);
+    ASSERT_TRUE(parsingResult.fragments.empty());
+    ASSERT_EQ(parsingResult.errors.size(), 1);
+    ASSERT_EQ(parsingResult.errors[0].type, ParsingError::Type::UnexpectedEof);
+    ASSERT_EQ(parsingResult.errors[0].range, (Range { 1, 13, 1, 13 }));
+}
+
+TEST(ParsingTest, ElidedWhitespacesAndComments)
+{
+    TokenizationOptions options;
+    options.elideWhitespaces = true;
+    options.skipComments     = true;
+
+    auto tokenizationResult = Tokenize(_commentedCode, options);
+    ASSERT_TRUE(tokenizationResult.errors.empty());
+
+    auto parsingResult = Parse(tokenizationResult.tokens);
+    ASSERT_TRUE(parsingResult.errors.empty());
+
+    auto expected = Parse(Tokenize(_validCode2).tokens);
+
+    auto const& fragments = parsingResult.fragments;
+    ASSERT_EQ_VECTOR(fragments, expected.fragments, lit->data, rit->data);
 }
@@ -0,0 +1,75 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <gtest/gtest.h>
+#include <simple-mips-asm/Scanning.hh>
+
+#include <cctype>
+#include <random>
+#include <string>
+
+constexpr bool operator==(BlockMasks const& lhs, BlockMasks const& rhs) noexcept
+{
+    return lhs.newLines == rhs.newLines && lhs.delimiters == rhs.delimiters
+           && lhs.whitespaces == rhs.whitespaces && lhs.digits == rhs.digits
+           && lhs.hexDigits == rhs.hexDigits && lhs.wordCharacters == rhs.wordCharacters
+           && lhs.hashes == rhs.hashes;
+}
+
+TEST(ScanningTest, ScalarMasks)
+{
+    char const block[] = "main:  addiu $2, $0, 0xaF\r\n"
+                         "\t_x9: lb $2, 1($4) # @\x80\xff\v\f............................";
+    static_assert(sizeof(block) > BlockSize);
+
+    auto masks = GetBlockScanner(ScannerKind::Scalar)(block);
+    for (size_t i = 0; i < BlockSize; ++i)
+    {
+        auto c   = static_cast<unsigned char>(block[i]);
+        bool bit = false;
+
+        bit = (masks.newLines >> i) & 1;
+        ASSERT_EQ(bit, c == '\n') << i;
+        bit = (masks.whitespaces >> i) & 1;
+        ASSERT_EQ(bit, isspace(c) && c != '\n') << i;
+        bit = (masks.delimiters >> i) & 1;
+        ASSERT_EQ(bit, isspace(c) || std::string_view(".:$(),").find(c) != std::string_view::npos)
+            << i;
+        bit = (masks.digits >> i) & 1;
+        ASSERT_EQ(bit, c < 0x80 && isdigit(c)) << i;
+        bit = (masks.hexDigits >> i) & 1;
+        ASSERT_EQ(bit, c < 0x80 && isxdigit(c)) << i;
+        bit = (masks.wordCharacters >> i) & 1;
+        ASSERT_EQ(bit, (c < 0x80 && isalnum(c)) || c == '_') << i;
+        bit = (masks.hashes >> i) & 1;
+        ASSERT_EQ(bit, c == '#') << i;
+    }
+}
+
+TEST(ScanningTest, AllScannersAgree)
+{
+    auto scalar = GetBlockScanner(ScannerKind::Scalar);
+    auto sse2   = GetBlockScanner(ScannerKind::SSE2);
+    auto avx2   = GetBlockScanner(ScannerKind::AVX2);
+
+    std::mt19937 random { 0 };
+    char         block[BlockSize];
+    for (int i = 0; i < 10000; ++i)
+    {
+        for (char& c : block) c = static_cast<char>(random());
+
+        auto expected = scalar(block);
+        ASSERT_EQ(sse2(block), expected);
+        ASSERT_EQ(avx2(block), expected);
+    }
+}
+
+TEST(ScanningTest, CountNewLines)
+{
+    std::string code;
+    for (int i = 0; i < 1000; ++i) code += std::string(i % 97, 'a') + '\n';
+
+    ASSERT_EQ(CountNewLines(code), 1000);
+    ASSERT_EQ(CountNewLines(std::string_view(code).substr(0, 100)), 13);
+    ASSERT_EQ(CountNewLines(""), 0);
+}
@@ -0,0 +1,193 @@
+// Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
+// Licensed under the MIT License.
+
+#include <gtest/gtest.h>
+#include <simple-mips-asm/Generation.hh>
+#include <simple-mips-asm/Parsing.hh>
+#include <simple-mips-asm/Scheduling.hh>
+
+#include "TestCommon.hh"
+
+TEST(SchedulingTest, DelaySlots)
+{
+    auto parseResult = ParseCode("main: addu $2, $3, $4\n" // labelled
+                                 "j main\n"
+                                 "sll $0, $0, 0\n"
+                                 "addu $2, $3, $4\n"
+                                 "beq $5, $6, main\n"
+                                 "sll $0, $0, 0\n"
+                                 "addiu $5, $5, 1\n" // the operand of the branch
+                                 "bne $5, $6, main\n"
+                                 "sll $0, $0, 0\n"
+                                 "addu $2, $31, $0\n" // reads $ra
+                                 "jal f\n"
+                                 "sll $0, $0, 0\n"
+                                 "lw $10, 4($29)\n"
+                                 "jal f\n"
+                                 "sll $0, $0, 0\n"
+                                 "addu $7, $8, $9\n" // after a delay slot
+                                 "j main\n"
+                                 "sll $0, $0, 0\n"
+                                 "beq $1, $2, main\n"
+                                 "addu $3, $4, $5\n" // in a delay slot
+                                 "j main\n"
+                                 "sll $0, $0, 0\n"
+                                 "la $4, main\n" // an la
+                                 "j main\n"
+                                 "sll $0, $0, 0\n"
+                                 "f: addu $9, $9, $9\n"
+                                 "lw $31, 0($29)\n" // the operand of the jump
+                                 "jr $31\n"
+                                 "sll $0, $0, 0\n"
+                                 "beq $1, $2, main\n")
+                           .parseResult;
+    ASSERT_TRUE(parseResult.errors.empty());
+
+    auto report = FillDelaySlots(parseResult.fragments);
+    EXPECT_EQ(report.numFilledSlots, 3);
+    EXPECT_EQ(report.numNopSlots, 6);
+
+    auto expected = ParseCode("main: addu $2, $3, $4\n"
+                              "j main\n"
+                              "sll $0, $0, 0\n"
+                              "beq $5, $6, main\n"
+                              "addu $2, $3, $4\n"
+                              "addiu $5, $5, 1\n"
+                              "bne $5, $6, main\n"
+                              "sll $0, $0, 0\n"
+                              "addu $2, $31, $0\n"
+                              "jal f\n"
+                              "sll $0, $0, 0\n"
+                              "jal f\n"
+                              "lw $10, 4($29)\n"
+                              "j main\n"
+                              "addu $7, $8, $9\n"
+                              "beq $1, $2, main\n"
+                              "addu $3, $4, $5\n"
+                              "j main\n"
+                              "sll $0, $0, 0\n"
+                              "la $4, main\n"
+                              "j main\n"
+                              "sll $0, $0, 0\n"
+                              "f: addu $9, $9, $9\n"
+                              "lw $31, 0($29)\n"
+                              "jr $31\n"
+                              "sll $0, $0, 0\n"
+                              "beq $1, $2, main\n").parseResult;
+    ExpectSameResult(GenerateCode(parseResult.fragments), GenerateCode(expected.fragments));
+}
+
+TEST(SchedulingTest, DelaySlotsInDataSegment)
+{
+    // the instructions in the data segment are data words, and moving them would move x
+    char const* code = ".data\n"
+                       "addu $5, $6, $7\n"
+                       "beq $1, $2, x\n"
+                       "sll $0, $0, 0\n"
+                       "x: .word 3\n"
+                       ".text\n"
+                       "la $4, x\n";
+
+    auto parseResult = ParseCode(code).parseResult;
+    ASSERT_TRUE(parseResult.errors.empty());
+
+    auto report = FillDelaySlots(parseResult.fragments);
+    EXPECT_EQ(report.numFilledSlots, 0);
+    EXPECT_EQ(report.numNopSlots, 0);
+    ExpectSameResult(GenerateCode(parseResult.fragments),
+                     GenerateCode(ParseCode(code).parseResult.fragments), code);
+}
+
+TEST(SchedulingTest, LoadUse)
+{
+    auto parseResult = ParseCode("main: lw $2, 0($4)\n"
+                                 "addu $3, $2, $2\n"
+                                 "lw $5, 4($4)\n"
+                                 "addu $6, $5, $5\n"
+                                 "sw $6, 8($4)\n"
+                                 "lw $7, 8($4)\n" // after the store
+                                 "addu $8, $7, $0\n"
+                                 "beq $8, $0, main\n"
+                                 "a: lw $2, 0($4)\n"
+                                 "addu $3, $2, $0\n"
+                                 "addiu $4, $4, 4\n" // after the load reading $4
+                                 "lw $9, 0($4)\n"
+                                 "b: addu $10, $9, $0\n" // after the load before the label
+                                 "addu $11, $0, $0\n"
+                                 "jr $31\n")
+                           .parseResult;
+    ASSERT_TRUE(parseResult.errors.empty());
+
+    auto report = ScheduleLoads(parseResult.fragments);
+    EXPECT_EQ(report.numStallsBefore, 5);
+    EXPECT_EQ(report.numStallsAfter, 0);
+    EXPECT_EQ(CountLoadUseStalls(parseResult.fragments), 0);
+
+    // the longest path goes through the store, and the first addu is moved after the load after it
+    auto expected = ParseCode("main: lw $5, 4($4)\n"
+                              "lw $2, 0($4)\n"
+                              "addu $6, $5, $5\n"
+                              "sw $6, 8($4)\n"
+                              "lw $7, 8($4)\n"
+                              "addu $3, $2, $2\n"
+                              "addu $8, $7, $0\n"
+                              "beq $8, $0, main\n"
+                              "a: lw $2, 0($4)\n"
+                              "addiu $4, $4, 4\n"
+                              "addu $3, $2, $0\n"
+                              "lw $9, 0($4)\n"
+                              "b: addu $11, $0, $0\n"
+                              "addu $10, $9, $0\n"
+                              "jr $31\n").parseResult;
+    ExpectSameResult(GenerateCode(parseResult.fragments), GenerateCode(expected.fragments));
+}
+
+TEST(SchedulingTest, LoadUseInDataSegment)
+{
+    // the words of the data segment are not a basic block, and have no stalls
+    char const* code = ".data\n"
+                       "table: sll $0, $0, 0\n"
+                       "lw $2, 0($4)\n"
+                       "addu $3, $2, $2\n"
+                       "addu $5, $6, $7\n"
+                       ".text\n"
+                       "la $4, table\n"
+                       "lw $2, 4($4)\n";
+
+    auto parseResult = ParseCode(code).parseResult;
+    ASSERT_TRUE(parseResult.errors.empty());
+
+    auto report = ScheduleLoads(parseResult.fragments);
+    EXPECT_EQ(report.numStallsBefore, 0);
+    EXPECT_EQ(report.numStallsAfter, 0);
+    ExpectSameResult(GenerateCode(parseResult.fragments),
+                     GenerateCode(ParseCode(code).parseResult.fragments), code);
+}
+
+TEST(SchedulingTest, LoadUseWithDelaySlots)
+{
+    char const* code = "main: beq $1, $2, main\n"
+                       "addu $5, $6, $7\n"
+                       "lw $2, 0($4)\n"
+                       "addu $3, $2, $0\n";
+
+    // the instruction in the delay slot is not moved after the load
+    auto parseResult = ParseCode(code).parseResult;
+    auto report      = ScheduleLoads(parseResult.fragments);
+    EXPECT_EQ(report.numStallsBefore, 1);
+    EXPECT_EQ(report.numStallsAfter, 0);
+    auto expected = ParseCode("main: beq $1, $2, main\n"
+                              "lw $2, 0($4)\n"
+                              "addu $5, $6, $7\n"
+                              "addu $3, $2, $0\n").parseResult;
+    ExpectSameResult(GenerateCode(parseResult.fragments), GenerateCode(expected.fragments));
+
+    SchedulingOptions options;
+    options.hasDelaySlots = true;
+    parseResult           = ParseCode(code).parseResult;
+    report                = ScheduleLoads(parseResult.fragments, options);
+    EXPECT_EQ(report.numStallsBefore, 1);
+    EXPECT_EQ(report.numStallsAfter, 1);
+    ExpectSameResult(GenerateCode(parseResult.fragments),
+                     GenerateCode(ParseCode(code).parseResult.fragments), code);
+}
@@ -1,6 +1,15 @@
 // Copyright (c) 2021 Chanjung Kim (paxbun). All rights reserved.
 // Licensed under the MIT License.
 
+#ifndef SIMPLE_MIPS_ASM_TEST_COMMON_HH
+#define SIMPLE_MIPS_ASM_TEST_COMMON_HH
+
+#include <gtest/gtest.h>
+#include <simple-mips-asm/Generation.hh>
+
+#include <string>
+#include <variant>
+
 #define ASSERT_EQ_VECTOR(l, r, litExpr, ritExpr)                                                   \
     {                                                                                              \
         ASSERT_EQ((l).size(), (r).size());                                                         \
@@ -8,3 +17,30 @@
         auto rit = (r).begin(), rend = (r).end();                                                  \
         for (; lit != lend && rit != rend; ++lit, ++rit) ASSERT_EQ((litExpr), (ritExpr));          \
     }
+
+/// <summary>
+/// Checks whether the given generation results have the same words, or the same errors. The given
+/// code is printed if they are different.
+/// </summary>
+inline void ExpectSameResult(GenerationResult const& result,
+                             GenerationResult const& expected,
+                             std::string const&      code = {})
+{
+    ASSERT_EQ(result.index(), expected.index()) << code;
+    if (std::holds_alternative<CanGenerate>(expected))
+    {
+        auto const& [data, text]                 = std::get<CanGenerate>(result);
+        auto const& [expectedData, expectedText] = std::get<CanGenerate>(expected);
+        ASSERT_EQ(data, expectedData) << code;
+        ASSERT_EQ(text, expectedText) << code;
+    }
+    else
+    {
+        auto const& errors         = std::get<CannotGenerate>(result).errors;
+        auto const& expectedErrors = std::get<CannotGenerate>(expected).errors;
+        ASSERT_EQ_VECTOR(errors, expectedErrors, lit->type, rit->type);
+        ASSERT_EQ_VECTOR(errors, expectedErrors, lit->range.begin.line, rit->range.begin.line);
+    }
+}
+
+#endif
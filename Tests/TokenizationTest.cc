@@ -5,6 +5,7 @@
 #include <simple-mips-asm/Tokenization.hh>
 
 #include "TestCommon.hh"
+#include <string>
 
 #define T(n) Token::Type::n
 
@@ -108,4 +109,145 @@ TEST(TokenizationTest, CodeWithInvalidFormat)
         auto const& tokens = result.tokens;
         ASSERT_EQ_VECTOR(tokens, expected, lit->type, *rit);
     }
-}
\ No newline at end of file
+}
+
+TEST(TokenizationTest, InvalidCharacters)
+{
+    auto result = Tokenize("@0x -\r\n_a1 0X1 #");
+
+    {
+        std::vector<std::pair<TokenizationError::Type, Range>> expected {
+            { TokenizationError::Type::InvalidCharacter, Range { 1, 1, 1, 2 } },
+            { TokenizationError::Type::InvalidFormat, Range { 2, 5, 2, 8 } },
+            { TokenizationError::Type::InvalidCharacter, Range { 2, 9, 2, 10 } },
+        };
+
+        auto const& errors = result.errors;
+        ASSERT_EQ_VECTOR(errors, expected, std::make_pair(lit->type, lit->range), *rit);
+    }
+
+    {
+        // clang-format off
+        std::vector<Token::Type> expected {
+            // @0x -\r
+            T(HexInteger), T(Whitespace), T(Integer), T(Whitespace), T(NewLine),
+            // _a1 0X1 #
+            T(Word), T(Whitespace), T(Integer), T(Whitespace),
+        };
+        // clang-format on
+
+        auto const& tokens = result.tokens;
+        ASSERT_EQ_VECTOR(tokens, expected, lit->type, *rit);
+    }
+}
+
+TEST(TokenizationTest, CompactTokens)
+{
+    auto result  = Tokenize(_codeWithInvalidFormat);
+    auto compact = TokenizeCompact(_codeWithInvalidFormat);
+
+    auto const& errors = compact.errors;
+    ASSERT_EQ_VECTOR(errors, result.errors, lit->range, rit->range);
+
+    auto const& tokens = compact.tokens;
+    ASSERT_EQ(tokens.size(), result.tokens.size());
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        ASSERT_EQ(tokens.types[i], result.tokens[i].type);
+        ASSERT_EQ(tokens.GetValue(i), result.tokens[i].value);
+        ASSERT_EQ(tokens.GetRange(i), result.tokens[i].range);
+    }
+}
+
+TEST(TokenizationTest, ElideWhitespacesAndSkipComments)
+{
+    TokenizationOptions options;
+    options.elideWhitespaces = true;
+    options.skipComments     = true;
+
+    auto result = Tokenize("# header\n"
+                           "main:  addiu $2, $3, 14 # comment\n"
+                           "       jr $31#comment\n",
+                           options);
+    ASSERT_TRUE(result.errors.empty());
+
+    // clang-format off
+    std::vector<Token::Type> expected {
+        T(NewLine),
+        // main: addiu $2, $3, 14
+        T(Word), T(Colon), T(Word), T(Dollar), T(Integer), T(Comma),
+            T(Dollar), T(Integer), T(Comma), T(Integer), T(NewLine),
+        // jr $31
+        T(Word), T(Dollar), T(Integer), T(NewLine),
+    };
+    // clang-format on
+
+    auto const& tokens = result.tokens;
+    ASSERT_EQ_VECTOR(tokens, expected, lit->type, *rit);
+    ASSERT_EQ(tokens[3].range, (Range { 2, 8, 2, 13 }));
+    ASSERT_EQ(tokens[15].range, (Range { 3, 22, 4, 1 }));
+}
+
+TEST(TokenizationTest, CommentsAreInvalidByDefault)
+{
+    auto result = Tokenize("jr $31 # comment");
+
+    std::vector<Range> expected { Range { 1, 8, 1, 9 } };
+
+    auto const& errors = result.errors;
+    ASSERT_EQ_VECTOR(errors, expected, lit->range, *rit);
+}
+
+TEST(TokenizationTest, Parallel)
+{
+    std::string code;
+    for (int i = 0; i < 200; ++i)
+    {
+        code += _validCode;
+        code += _codeWithInvalidFormat;
+    }
+
+    auto expected = Tokenize(code);
+
+    ParallelOptions parallelOptions;
+    parallelOptions.numThreads = 4;
+    parallelOptions.chunkSize  = 100;
+
+    auto result = TokenizeParallel(code, {}, parallelOptions);
+
+    auto const& tokens = result.tokens;
+    ASSERT_EQ_VECTOR(tokens, expected.tokens, lit->type, rit->type);
+    ASSERT_EQ_VECTOR(tokens, expected.tokens, lit->range, rit->range);
+    ASSERT_EQ_VECTOR(tokens, expected.tokens, lit->value.data(), rit->value.data());
+
+    auto const& errors = result.errors;
+    ASSERT_EQ_VECTOR(errors, expected.errors, lit->type, rit->type);
+    ASSERT_EQ_VECTOR(errors, expected.errors, lit->range, rit->range);
+}
+
+TEST(TokenizationTest, Stream)
+{
+    std::string code = std::string { _validCode } + _codeWithInvalidFormat + "\tjr $31";
+
+    auto expected = Tokenize(code);
+
+    TokenStream        stream { code };
+    std::vector<Token> tokens;
+    std::vector<Token> line;
+    while (stream.NextLine(line))
+    {
+        ASSERT_FALSE(line.empty());
+        for (size_t i = 0; i + 1 < line.size(); ++i)
+            ASSERT_NE(line[i].type, Token::Type::NewLine);
+        tokens.insert(tokens.end(), line.begin(), line.end());
+    }
+    ASSERT_TRUE(line.empty());
+
+    ASSERT_EQ_VECTOR(tokens, expected.tokens, lit->type, rit->type);
+    ASSERT_EQ_VECTOR(tokens, expected.tokens, lit->range, rit->range);
+    ASSERT_EQ_VECTOR(tokens, expected.tokens, lit->value.data(), rit->value.data());
+
+    auto const& errors = stream.GetErrors();
+    ASSERT_EQ_VECTOR(errors, expected.errors, lit->type, rit->type);
+    ASSERT_EQ_VECTOR(errors, expected.errors, lit->range, rit->range);
+}